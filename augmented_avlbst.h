@@ -0,0 +1,419 @@
+#ifndef AUGMENTED_AVLBST_H
+#define AUGMENTED_AVLBST_H
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "avlbst.h"
+
+/**
+* Summaries for AugmentedAVLTree. A monoid names its Summary type and gives
+*   identity()          the summary of no entries
+*   of(key, value)      the summary of one entry
+*   combine(a, b)       the summary of a's entries followed by b's
+* combine must be associative but need not be commutative: it is always
+* called with the lower keys on the left. identity is only needed by
+* aggregate.
+*/
+template <typename Key, typename Value>
+struct SumMonoid
+{
+    typedef Value Summary;
+    static Summary identity() { return Value(); }
+    static Summary of(const Key&, const Value& value) { return value; }
+    static Summary combine(const Summary& a, const Summary& b) { return a + b; }
+};
+
+template <typename Key, typename Value>
+struct MinMonoid
+{
+    typedef Value Summary;
+    static Summary identity() { return std::numeric_limits<Value>::max(); }
+    static Summary of(const Key&, const Value& value) { return value; }
+    static Summary combine(const Summary& a, const Summary& b) { return b < a ? b : a; }
+};
+
+template <typename Key, typename Value>
+struct MaxMonoid
+{
+    typedef Value Summary;
+    static Summary identity() { return std::numeric_limits<Value>::lowest(); }
+    static Summary of(const Key&, const Value& value) { return value; }
+    static Summary combine(const Summary& a, const Summary& b) { return a < b ? b : a; }
+};
+
+// The number of entries, which is what OrderStatisticTree keeps
+template <typename Key, typename Value>
+struct CountMonoid
+{
+    typedef size_t Summary;
+    static Summary identity() { return 0; }
+    static Summary of(const Key&, const Value&) { return 1; }
+    static Summary combine(const Summary& a, const Summary& b) { return a + b; }
+};
+
+/**
+* A node of an AugmentedAVLTree, holding the summary of its subtree.
+*/
+template <typename Key, typename Value, typename Summary>
+class AugmentedNode : public AVLNode<Key, Value>
+{
+public:
+    AugmentedNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+        AVLNode<Key, Value>(key, value, parent), summary_()
+    {
+    }
+
+    const Summary& getSummary() const { return summary_; }
+    void setSummary(const Summary& summary) { summary_ = summary; }
+
+    AugmentedNode<Key, Value, Summary>* getParent() const override
+    {
+        return static_cast<AugmentedNode<Key, Value, Summary>*>(this->parent_);
+    }
+    AugmentedNode<Key, Value, Summary>* getLeft() const override
+    {
+        return static_cast<AugmentedNode<Key, Value, Summary>*>(this->left_);
+    }
+    AugmentedNode<Key, Value, Summary>* getRight() const override
+    {
+        return static_cast<AugmentedNode<Key, Value, Summary>*>(this->right_);
+    }
+
+protected:
+    Summary summary_;
+};
+
+/**
+* Iterates over a tree like AVLTree::iterator, but only gives const access
+* to the entries, so values cannot be changed behind the tree's back.
+*/
+template <typename Key, typename Value>
+class ConstTreeIterator
+{
+public:
+    typedef typename AVLTree<Key, Value>::iterator TreeIterator;
+
+    ConstTreeIterator() {}
+    explicit ConstTreeIterator(const TreeIterator& it) : it_(it) {}
+
+    const std::pair<const Key, Value>& operator*() const { return *it_; }
+    const std::pair<const Key, Value>* operator->() const { return it_.operator->(); }
+
+    bool operator==(const ConstTreeIterator& rhs) const { return it_ == rhs.it_; }
+    bool operator!=(const ConstTreeIterator& rhs) const { return it_ != rhs.it_; }
+
+    ConstTreeIterator& operator++() { ++it_; return *this; }
+
+private:
+    TreeIterator it_;
+};
+
+/**
+* An AVLTree whose nodes each keep Monoid's summary of their subtree, kept
+* current through the AVLTree augmentation hooks. aggregate(lo, hi)
+* combines the summaries of O(log n) nodes and subtrees instead of visiting
+* every entry in the range.
+*
+* Values must only change through insert, so mutable access is not
+* offered: operator[] is const and iterators are ConstTreeIterators.
+*/
+template <typename Key, typename Value, typename Monoid>
+class AugmentedAVLTree : protected AVLTree<Key, Value>
+{
+public:
+    typedef typename Monoid::Summary Summary;
+    typedef AVLTree<Key, Value> Base;
+    typedef ConstTreeIterator<Key, Value> iterator;
+
+    AugmentedAVLTree();
+    AugmentedAVLTree(const AugmentedAVLTree<Key, Value, Monoid>& other);
+
+    void insert(const std::pair<const Key, Value>& item);
+    void remove(const Key& key);
+    const Value& operator[](const Key& key) const;
+    Summary aggregate(const Key& lo, const Key& hi) const;
+    Summary total() const;
+
+    iterator begin() const { return iterator(Base::begin()); }
+    iterator end() const { return iterator(Base::end()); }
+    iterator find(const Key& key) const { return iterator(Base::find(key)); }
+
+    using Base::empty;
+    using Base::clear;
+    using Base::height;
+    using Base::enableFindFilter;
+    using Base::disableFindFilter;
+    using Base::enableFindCache;
+    using Base::disableFindCache;
+    using Base::findCacheStats;
+
+protected:
+    typedef AugmentedNode<Key, Value, Summary> ANode;
+
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+    virtual void nodeSwap(AVLNode<Key, Value>* n1, AVLNode<Key, Value>* n2);
+    virtual void updateAugment(AVLNode<Key, Value>* node);
+    virtual void updateAugmentPath(AVLNode<Key, Value>* node);
+
+    ANode* root() const { return static_cast<ANode*>(this->root_); }
+    static void recompute(ANode* node);
+
+private:
+    AugmentedAVLTree<Key, Value, Monoid>& operator=(const AugmentedAVLTree<Key, Value, Monoid>&);
+};
+
+template<typename Key, typename Value, typename Monoid>
+AugmentedAVLTree<Key, Value, Monoid>::AugmentedAVLTree() : Base()
+{
+}
+
+/**
+* Copies other's nodes, summaries included, like the AVLTree copy constructor.
+*/
+template<typename Key, typename Value, typename Monoid>
+AugmentedAVLTree<Key, Value, Monoid>::AugmentedAVLTree(const AugmentedAVLTree<Key, Value, Monoid>& other) : Base()
+{
+    this->copyFrom(other);
+}
+
+/**
+* Inserts item, or replaces the value of its key, updating the summaries.
+*/
+template<typename Key, typename Value, typename Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::insert(const std::pair<const Key, Value>& item)
+{
+    this->insertNode(item);
+}
+
+template<typename Key, typename Value, typename Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::remove(const Key& key)
+{
+    Base::remove(key);
+}
+
+/**
+* @precondition The key exists in the map
+* Returns the value associated with the key
+*/
+template<typename Key, typename Value, typename Monoid>
+const Value& AugmentedAVLTree<Key, Value, Monoid>::operator[](const Key& key) const
+{
+    return Base::operator[](key);
+}
+
+/**
+* The summary of every entry, or identity if the tree is empty. O(1).
+*/
+template<typename Key, typename Value, typename Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary AugmentedAVLTree<Key, Value, Monoid>::total() const
+{
+    return root() == nullptr ? Monoid::identity() : root()->getSummary();
+}
+
+/**
+* The summary of the entries with lo <= key <= hi, in key order, or
+* identity if there are none.
+*
+* The search for lo and the search for hi share a path down to the first
+* key inside the range. Below it, every node on the lo path that is in the
+* range brings its right subtree along whole, and likewise every node on
+* the hi path brings its left subtree, so O(log n) summaries are combined.
+*/
+template<typename Key, typename Value, typename Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary
+AugmentedAVLTree<Key, Value, Monoid>::aggregate(const Key& lo, const Key& hi) const
+{
+    //find where the two searches part
+    ANode* split = root();
+    while(split != nullptr) {
+        if(split->getKey() < lo) {
+            split = split->getRight();
+        }
+        else if(hi < split->getKey()) {
+            split = split->getLeft();
+        }
+        else {
+            break;
+        }
+    }
+    if(split == nullptr) {
+        return Monoid::identity();
+    }
+
+    //the lo path finds ever smaller keys, so its pieces go on the left
+    Summary low = Monoid::identity();
+    for(ANode* node = split->getLeft(); node != nullptr; ) {
+        if(node->getKey() < lo) {
+            node = node->getRight();
+        }
+        else {
+            Summary piece = Monoid::of(node->getKey(), node->getValue());
+            if(node->getRight() != nullptr) {
+                piece = Monoid::combine(piece, node->getRight()->getSummary());
+            }
+            low = Monoid::combine(piece, low);
+            node = node->getLeft();
+        }
+    }
+
+    //and the hi path finds ever larger keys, so its pieces go on the right
+    Summary high = Monoid::identity();
+    for(ANode* node = split->getRight(); node != nullptr; ) {
+        if(hi < node->getKey()) {
+            node = node->getLeft();
+        }
+        else {
+            Summary piece = Monoid::of(node->getKey(), node->getValue());
+            if(node->getLeft() != nullptr) {
+                piece = Monoid::combine(node->getLeft()->getSummary(), piece);
+            }
+            high = Monoid::combine(high, piece);
+            node = node->getRight();
+        }
+    }
+    return Monoid::combine(Monoid::combine(low, Monoid::of(split->getKey(), split->getValue())), high);
+}
+
+template<typename Key, typename Value, typename Monoid>
+AVLNode<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::createNode(const Key& key, const Value& value,
+                                                                      AVLNode<Key, Value>* parent)
+{
+    ANode* node = this->allocateNode(key, value, static_cast<ANode*>(parent));
+    node->setSummary(Monoid::of(key, value));
+    return node;
+}
+
+template<typename Key, typename Value, typename Monoid>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::cloneTree(const Node<Key, Value>* src,
+                                                                  Node<Key, Value>* parent) const
+{
+    if(src == nullptr) {
+        return nullptr;
+    }
+    const ANode* augmentedSrc = static_cast<const ANode*>(src);
+    ANode* copy = this->allocateNode(augmentedSrc->getKey(), augmentedSrc->getValue(), static_cast<ANode*>(parent));
+    copy->setBalance(augmentedSrc->getBalance());
+    copy->setSummary(augmentedSrc->getSummary());
+    copy->setLeft(cloneTree(augmentedSrc->getLeft(), copy));
+    copy->setRight(cloneTree(augmentedSrc->getRight(), copy));
+    return copy;
+}
+
+/**
+* Summaries belong to positions in the tree, like balances, so they trade
+* places too.
+*/
+template<typename Key, typename Value, typename Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::nodeSwap(AVLNode<Key, Value>* n1, AVLNode<Key, Value>* n2)
+{
+    Base::nodeSwap(n1, n2);
+    ANode* a1 = static_cast<ANode*>(n1);
+    ANode* a2 = static_cast<ANode*>(n2);
+    Summary summary = a1->getSummary();
+    a1->setSummary(a2->getSummary());
+    a2->setSummary(summary);
+}
+
+// Recomputes node's summary from its own entry and its children
+template<typename Key, typename Value, typename Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::recompute(ANode* node)
+{
+    Summary summary = Monoid::of(node->getKey(), node->getValue());
+    if(node->getLeft() != nullptr) {
+        summary = Monoid::combine(node->getLeft()->getSummary(), summary);
+    }
+    if(node->getRight() != nullptr) {
+        summary = Monoid::combine(summary, node->getRight()->getSummary());
+    }
+    node->setSummary(summary);
+}
+
+template<typename Key, typename Value, typename Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::updateAugment(AVLNode<Key, Value>* node)
+{
+    recompute(static_cast<ANode*>(node));
+}
+
+/**
+* Walks all the way up from node. Stopping at the first unchanged summary
+* would be wrong after a remove: the nodes between the removed node and the
+* predecessor it was swapped with still count the predecessor's entry.
+*/
+template<typename Key, typename Value, typename Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::updateAugmentPath(AVLNode<Key, Value>* node)
+{
+    for(ANode* current = static_cast<ANode*>(node); current != nullptr; current = current->getParent()) {
+        recompute(current);
+    }
+}
+
+/**
+* An AugmentedAVLTree counting the entries of each subtree, which answers
+* rank and select queries in O(log n).
+*/
+template <typename Key, typename Value>
+class OrderStatisticTree : public AugmentedAVLTree<Key, Value, CountMonoid<Key, Value> >
+{
+public:
+    typedef AugmentedAVLTree<Key, Value, CountMonoid<Key, Value> > Augmented;
+    typedef typename Augmented::iterator iterator;
+
+    size_t size() const { return this->total(); }
+    size_t rank(const Key& key) const;
+    iterator select(size_t index) const;
+
+protected:
+    typedef typename Augmented::ANode ANode;
+
+    static size_t count(const ANode* node) { return node == nullptr ? 0 : node->getSummary(); }
+};
+
+/**
+* The number of keys less than key, whether or not key is present.
+*/
+template<typename Key, typename Value>
+size_t OrderStatisticTree<Key, Value>::rank(const Key& key) const
+{
+    size_t below = 0;
+    for(const ANode* node = this->root(); node != nullptr; ) {
+        if(node->getKey() < key) {
+            below += count(node->getLeft()) + 1;
+            node = node->getRight();
+        }
+        else {
+            node = node->getLeft();
+        }
+    }
+    return below;
+}
+
+/**
+* An iterator to the entry with index keys before it, so select(0) is
+* begin. Throws std::out_of_range if index >= size().
+*/
+template<typename Key, typename Value>
+typename OrderStatisticTree<Key, Value>::iterator OrderStatisticTree<Key, Value>::select(size_t index) const
+{
+    if(index >= size()) {
+        throw std::out_of_range("select index past the end");
+    }
+    const ANode* node = this->root();
+    while(true) {
+        size_t left = count(node->getLeft());
+        if(index < left) {
+            node = node->getLeft();
+        }
+        else if(index == left) {
+            return this->find(node->getKey());
+        }
+        else {
+            index -= left + 1;
+            node = node->getRight();
+        }
+    }
+}
+
+#endif
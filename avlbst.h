@@ -5,11 +5,84 @@
 #include <exception>
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 #include "bst.h"
 
 struct KeyError { };
 
+/**
+* Header of the binary format written by AVLTree::save. Records follow it
+* in key order, each being the raw bytes of the key then of the value, in
+* the byte order of the machine that wrote them.
+*/
+struct AVLFileHeader
+{
+    char magic[4];          // "AVLT"
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint64_t count;
+};
+
+static const char AVL_FILE_MAGIC[4] = {'A', 'V', 'L', 'T'};
+static const uint32_t AVL_FILE_VERSION = 1;
+
+/**
+* Hands out a known number of fixed-size records from an input stream,
+* refilling an internal buffer in large blocks so the stream is read in
+* few calls. Never reads past the last record.
+*/
+class AVLBlockReader
+{
+public:
+    AVLBlockReader(std::istream& in, size_t recordSize, uint64_t count) :
+        in_(in), recordSize_(recordSize), remaining_(count),
+        buffer_(recordsPerBlock(recordSize) * recordSize), pos_(0), end_(0)
+    {
+    }
+
+    // Returns a pointer to the next record, or throws if the stream runs out.
+    const char* next()
+    {
+        if(pos_ == end_) {
+            uint64_t records = std::min<uint64_t>(remaining_, buffer_.size() / recordSize_);
+            end_ = static_cast<size_t>(records) * recordSize_;
+            pos_ = 0;
+            if(records == 0) {
+                throw std::runtime_error("AVL file has fewer records than its header says");
+            }
+            in_.read(&buffer_[0], end_);
+            if(static_cast<size_t>(in_.gcount()) != end_) {
+                throw std::runtime_error("AVL file is truncated");
+            }
+            remaining_ -= records;
+        }
+        const char* record = &buffer_[pos_];
+        pos_ += recordSize_;
+        return record;
+    }
+
+private:
+    static size_t recordsPerBlock(size_t recordSize)
+    {
+        const size_t blockBytes = 1 << 20;
+        return recordSize >= blockBytes ? 1 : blockBytes / recordSize;
+    }
+
+    std::istream& in_;
+    size_t recordSize_;
+    uint64_t remaining_;
+    std::vector<char> buffer_;
+    size_t pos_;
+    size_t end_;
+};
+
 /**
 * A special kind of node for an AVL tree, which adds the balance as a data member, plus
 * other additional helper functions. You do NOT need to implement any functionality or
@@ -131,21 +204,149 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    AVLTree();
+    AVLTree(const AVLTree<Key, Value>& other);
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
     virtual void remove(const Key& key);  // TODO
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+    template<typename Predicate>
+    size_t remove_if(Predicate pred);
+    virtual bool isBalanced() const;
+    virtual int height() const;
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
 protected:
     virtual void nodeSwap(AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual Node<Key, Value>* cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const;
 
     // Add helper functions here
-    AVLNode<Key, Value>* insertHelper(AVLNode<Key, Value>* current, const std::pair<const Key, Value>& newItem, AVLNode<Key,Value>* parent);
     void removeFix(AVLNode<Key,Value>* node, int difference);
     void insertFix(AVLNode<Key,Value>* parent, AVLNode<Key,Value>* node); 
     void rotateRight(AVLNode<Key,Value>* node); 
     void rotateLeft(AVLNode<Key,Value>* node); 
+    AVLNode<Key, Value>* insertNode(const std::pair<const Key, Value>& new_item);
+    void removeNode(AVLNode<Key, Value>* node);
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual void updateAugment(AVLNode<Key, Value>* node);
+    virtual void updateAugmentPath(AVLNode<Key, Value>* node);
+    AVLNode<Key, Value>* buildBalanced(size_t count, AVLBlockReader& reader, int& height, const Key*& last);
+    AVLNode<Key, Value>* ownNode(AVLNode<Key, Value>* node, const Key& key);
+    static int checkedHeight(const AVLNode<Key, Value>* node);
 
 
 };
 
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree() : BinarySearchTree<Key, Value>()
+{
+
+}
+
+/**
+* Copy constructor. The base copy constructor would clone plain Nodes,
+* so the copy is made here where cloneTree dispatches to the AVL version.
+*/
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree(const AVLTree<Key, Value>& other) : BinarySearchTree<Key, Value>()
+{
+    this->copyFrom(other);
+}
+
+/**
+* Checks every node in O(n): its subtree heights may differ by at most one,
+* and its stored balance must be their actual difference, which insert,
+* remove and the rotations rely on.
+*/
+template<class Key, class Value>
+bool AVLTree<Key, Value>::isBalanced() const
+{
+    return checkedHeight(static_cast<const AVLNode<Key, Value>*>(this->root_)) != -1;
+}
+
+/**
+* The height of the subtree at node, or -1 as soon as a node is found whose
+* stored balance is wrong or out of range.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::checkedHeight(const AVLNode<Key, Value>* node)
+{
+    if(node == nullptr) {
+        return 0;
+    }
+    int left = checkedHeight(node->getLeft());
+    if(left == -1) {
+        return -1;
+    }
+    int right = checkedHeight(node->getRight());
+    if(right == -1 || right - left != node->getBalance() || std::abs(right - left) > 1) {
+        return -1;
+    }
+    return 1 + std::max(left, right);
+}
+
+/**
+* Returns the height of the tree in O(log n) by following the taller
+* child down from the root, as told by the balances.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::height() const
+{
+    int height = 0;
+    for(AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->root_); node != nullptr; ++height) {
+        node = node->getBalance() < 0 ? node->getLeft() : node->getRight();
+    }
+    return height;
+}
+
+/**
+* Clones the subtree at src as AVLNodes, keeping each node's balance
+* so no rotations or comparisons are needed.
+*/
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    if(src == nullptr){
+      return nullptr;
+    }
+    const AVLNode<Key, Value>* avlSrc = static_cast<const AVLNode<Key, Value>*>(src);
+    AVLNode<Key, Value>* copy = this->allocateNode(avlSrc->getKey(), avlSrc->getValue(), static_cast<AVLNode<Key, Value>*>(parent));
+    copy->setBalance(avlSrc->getBalance());
+    copy->setLeft(cloneTree(avlSrc->getLeft(), copy));
+    copy->setRight(cloneTree(avlSrc->getRight(), copy));
+    return copy;
+}
+
+/**
+* Makes the node for a newly inserted key. Subclasses that need a larger
+* node type, or bookkeeping per entry, override this.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent)
+{
+    return this->allocateNode(key, value, parent);
+}
+
+/**
+* Hooks for subclasses that keep a summary of each subtree in its root,
+* such as AugmentedAVLTree. updateAugment recomputes one node's summary
+* from its children and is called for both nodes of every rotation.
+* updateAugmentPath recomputes node and its ancestors after a leaf is
+* linked in, a node is unlinked below node, or node's value is replaced.
+* Both do nothing here.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::updateAugment(AVLNode<Key, Value>*)
+{
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::updateAugmentPath(AVLNode<Key, Value>*)
+{
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
@@ -157,6 +358,7 @@ void AVLTree<Key,Value>::rotateRight(AVLNode<Key,Value>* node){
     if(node == nullptr or node->getLeft() == nullptr){
         return; 
     }
+    BST_STAT_ADD(rotateRights, 1);
     
     //get the child, parent, and the right node of the child values 
     AVLNode<Key,Value>* child = node->getLeft();
@@ -191,6 +393,9 @@ void AVLTree<Key,Value>::rotateRight(AVLNode<Key,Value>* node){
             parent->setRight(child);
         }
     }
+    //node is now below child, so it is recomputed first
+    updateAugment(node);
+    updateAugment(child);
 }
 
 
@@ -200,6 +405,7 @@ void AVLTree<Key,Value>::rotateLeft(AVLNode<Key,Value>* node){
     if(node == nullptr or node->getRight() == nullptr){
         return; 
     }
+    BST_STAT_ADD(rotateLefts, 1);
     //get the child, parent, and the left node of the child values 
     AVLNode<Key,Value>* child = node->getRight();
     AVLNode<Key,Value>* changeNode = child->getLeft();
@@ -234,6 +440,8 @@ void AVLTree<Key,Value>::rotateLeft(AVLNode<Key,Value>* node){
         parent->setRight(child);
       }
     }
+    updateAugment(node);
+    updateAugment(child);
 }
 
 
@@ -243,6 +451,7 @@ void AVLTree<Key,Value>::removeFix(AVLNode<Key,Value>* node, int difference) {
   if(node == nullptr){
     return;
   }
+  BST_STAT_ADD(removeFixSteps, 1);
   //acquire the parent node 
   AVLNode<Key,Value>* parent = node->getParent(); 
   //alter next diff appropriately
@@ -372,6 +581,7 @@ void AVLTree<Key,Value>::insertFix(AVLNode<Key,Value>* parent, AVLNode<Key,Value
   if(grandparent == nullptr or parent == nullptr){
     return; 
   }
+  BST_STAT_ADD(insertFixSteps, 1);
   //check if left child 
   if(grandparent->getLeft() == parent){
     //add -1 to grandparents balance 
@@ -447,48 +657,55 @@ void AVLTree<Key,Value>::insertFix(AVLNode<Key,Value>* parent, AVLNode<Key,Value
   }
 }
 
-//same insertHelper as BST 
 template<class Key, class Value>
-AVLNode<Key, Value>* AVLTree<Key,Value>::insertHelper(AVLNode<Key, Value>* current, const std::pair<const Key, Value>& newItem, AVLNode<Key,Value>* parent) {
-  if(current == nullptr){
-    AVLNode<Key,Value>* newNode = new AVLNode<Key,Value>(newItem.first, newItem.second, parent);
-    newNode->setBalance(0);
-    return newNode;
-  }
-  if(newItem.first < current->getKey()){
-    current->setLeft(insertHelper(current->getLeft(), newItem, current));
-  }
-  else if(newItem.first > current->getKey()){
-    current->setRight(insertHelper(current->getRight(), newItem, current));
-  }
-  else if(newItem.first == current->getKey()){
-    current->setValue(newItem.second);
-  }
-
- return current;
+void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+{
+    insertNode(new_item);
 }
 
+/**
+* Inserts or overwrites new_item and returns the node that holds it.
+*/
 template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+AVLNode<Key, Value>* AVLTree<Key, Value>::insertNode(const std::pair<const Key, Value> &new_item)
 {
-    //static cast the root to an AVLnode
-    AVLNode<Key,Value>* tempRoot = static_cast<AVLNode<Key,Value>*>(this->root_);
-    tempRoot = this->insertHelper(tempRoot, new_item, nullptr);
-
-    //set the root to the avl node temproot
-    this->root_ = tempRoot;
-    //find the key that was inserted 
-    AVLNode<Key,Value>* insertedNode = static_cast<AVLNode<Key,Value>*>(this->internalFind(new_item.first)); 
-    //if null then return 
-    if(insertedNode == nullptr){
-      return; 
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
+    //walk down to the insertion point, overwriting the value if the key is already present
+    AVLNode<Key,Value>* current = static_cast<AVLNode<Key,Value>*>(this->root_);
+    AVLNode<Key,Value>* parent = nullptr;
+    while(current != nullptr){
+      parent = current;
+      BST_STAT_ADD(comparisons, 1);
+      if(new_item.first < current->getKey()){
+        current = current->getLeft();
+      }
+      else if(BST_STAT_ADD(comparisons, 1), new_item.first > current->getKey()){
+        current = current->getRight();
+      }
+      else{
+        //an existing key leaves the shape and balances untouched, but summaries may depend on the value
+        current->setValue(new_item.second);
+        updateAugmentPath(current);
+        return current;
+      }
     }
-    //get the parent node 
-    AVLNode<Key,Value>* parent = insertedNode->getParent(); 
 
+    AVLNode<Key,Value>* insertedNode = createNode(new_item.first, new_item.second, parent);
+    //if null then the new node is the root
     if(parent == nullptr){
-      return; 
+      this->root_ = insertedNode;
+      return insertedNode; 
+    }
+    if(new_item.first < parent->getKey()){
+      parent->setLeft(insertedNode);
     }
+    else{
+      parent->setRight(insertedNode);
+    }
+    //summaries must be right before insertFix rotates
+    updateAugmentPath(parent);
+
     //update the balances according to the parent<->insertedNode relationship
     if(parent->getBalance() == 1 or parent->getBalance() == -1){
       if(parent->getRight() == insertedNode){
@@ -497,7 +714,7 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
       else{
         parent->updateBalance(-1);
       }
-      return; 
+      return insertedNode; 
     }
 
     if(parent->getBalance() == 0) {
@@ -510,6 +727,7 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
       //call insertFix if the parent balance was initially 0
       insertFix(parent, insertedNode);
     }
+    return insertedNode;
 }
 
 /*
@@ -520,29 +738,40 @@ template<class Key, class Value>
 void AVLTree<Key, Value>:: remove(const Key& key)
 {
     // TODO
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
     //find the node to remove 
     AVLNode<Key,Value>* removeNode = static_cast<AVLNode<Key,Value>*>(this->internalFind(key));
     //if it doesnt exist, then return 
     if(removeNode == nullptr){
       return; 
     }
+    this->removeNode(removeNode);
+}
 
+/**
+* Unlinks node from the tree, rebalances and frees it. For callers that
+* already hold the node, such as OrderedLRUCache evicting its coldest entry.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNode(AVLNode<Key, Value>* node)
+{
     //same implementation as BST remove but static cast to an avl node 
     AVLNode<Key,Value>* pred = nullptr;
-    if(removeNode->getLeft() != nullptr and removeNode->getRight() != nullptr){
-      pred = static_cast<AVLNode<Key,Value>*>(this->predecessor(removeNode));
+    if(node->getLeft() != nullptr and node->getRight() != nullptr){
+      pred = static_cast<AVLNode<Key,Value>*>(this->predecessor(node));
       if(pred!=nullptr){
-        nodeSwap(removeNode, pred);
+        nodeSwap(node, pred);
       }
     }
     //set difference to 0
     int diff = 0; 
 
-    //get the parent of the removeNode 
-    AVLNode<Key,Value>* parent = removeNode->getParent(); 
-    //if the parent is not null, diff = 1 if removeNode is left child and -1 if it is right child 
+    //get the parent of the node 
+    AVLNode<Key,Value>* parent = node->getParent(); 
+    //if the parent is not null, diff = 1 if node is left child and -1 if it is right child 
     if(parent != nullptr){
-      if(parent->getLeft() == removeNode){
+      if(parent->getLeft() == node){
         diff = 1; 
       }
       else{
@@ -552,13 +781,13 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 
     
     //same implementation as BST remove for if there is 0 or 1 children 
-    if (removeNode->getLeft() == nullptr and removeNode->getRight() == nullptr){
-        if(removeNode->getParent() != nullptr) {
-            if(removeNode->getParent()->getRight() == removeNode){
-                removeNode->getParent()->setRight(nullptr); 
+    if (node->getLeft() == nullptr and node->getRight() == nullptr){
+        if(node->getParent() != nullptr) {
+            if(node->getParent()->getRight() == node){
+                node->getParent()->setRight(nullptr); 
             }
             else{
-                removeNode->getParent()->setLeft(nullptr); 
+                node->getParent()->setLeft(nullptr); 
             }
         }
         else {
@@ -566,13 +795,13 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         }
     }
     else {
-        if (removeNode == this->root_) {
+        if (node == this->root_) {
             AVLNode<Key, Value>* child = nullptr;
-            if (removeNode->getRight() != nullptr and removeNode->getLeft() == nullptr) {
-                child = removeNode->getRight();
+            if (node->getRight() != nullptr and node->getLeft() == nullptr) {
+                child = node->getRight();
             }
-            if (removeNode->getRight() == nullptr and removeNode->getLeft() != nullptr) {
-                child = removeNode->getLeft();
+            if (node->getRight() == nullptr and node->getLeft() != nullptr) {
+                child = node->getLeft();
             }
             this->root_ = child;
             if(child != nullptr) {
@@ -581,13 +810,13 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         } 
         else {
             AVLNode<Key, Value>* child = nullptr; 
-            bool leftBool = (parent->getLeft() == removeNode);
+            bool leftBool = (parent->getLeft() == node);
 
-            if (removeNode->getLeft() != nullptr) {
-                child = removeNode->getLeft(); 
+            if (node->getLeft() != nullptr) {
+                child = node->getLeft(); 
             }
-            else if (removeNode->getRight() != nullptr) {
-                child = removeNode->getRight();
+            else if (node->getRight() != nullptr) {
+                child = node->getRight();
             }
           
             if (parent != nullptr) {
@@ -609,15 +838,109 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         } 
     }
 
+    updateAugmentPath(parent);
     //delete the node 
-    delete removeNode; 
+    this->freeNode(node); 
     //call removeFix on the parent and difference value 
     removeFix(parent, diff);
+    this->noteRemoval();
     //return
     return; 
 }
 
 
+/**
+* Removes the entry at pos and returns an iterator to the one after it.
+* Unlike remove, no search is needed. Iterators to other entries stay valid.
+*/
+template<class Key, class Value>
+typename AVLTree<Key, Value>::iterator AVLTree<Key, Value>::erase(iterator pos)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(pos));
+    node = ownNode(node, node->getKey());
+    this->reclaim(this->reclaimBudget_);
+    AVLNode<Key, Value>* next = static_cast<AVLNode<Key, Value>*>(this->successor(node));
+    removeNode(node);
+    return this->nodeIterator(next);
+}
+
+/**
+* Removes the entries in [first, last) and returns last, in one in-order
+* pass that removes each node as it is reached. No searches are done, and
+* iterators to the surviving entries stay valid.
+*
+* Removing the nodes in key order keeps the paths being rebalanced in
+* cache, which made this about twice as fast as relinking the survivors
+* into a new balanced tree, even with 99% of the entries erased.
+*/
+template<class Key, class Value>
+typename AVLTree<Key, Value>::iterator AVLTree<Key, Value>::erase(iterator first, iterator last)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(first));
+    AVLNode<Key, Value>* stop = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(last));
+    if(node == stop) {
+        return last;
+    }
+    if(stop != nullptr) {
+        //ownNode may copy the tree, so both ends are looked up by key before it does
+        const Key stopKey = stop->getKey();
+        node = ownNode(node, node->getKey());
+        stop = static_cast<AVLNode<Key, Value>*>(this->internalFind(stopKey));
+    }
+    else {
+        node = ownNode(node, node->getKey());
+    }
+    this->reclaim(this->reclaimBudget_);
+    while(node != stop) {
+        //removeNode may swap node with its predecessor, but never moves its successor
+        AVLNode<Key, Value>* next = static_cast<AVLNode<Key, Value>*>(this->successor(node));
+        removeNode(node);
+        node = next;
+    }
+    return this->nodeIterator(stop);
+}
+
+/**
+* Removes every entry for which pred(item) is true, calling pred once per
+* entry in key order, and returns how many were removed. Like
+* erase(first, last) it works in a single in-order pass without searches.
+*/
+template<class Key, class Value>
+template<typename Predicate>
+size_t AVLTree<Key, Value>::remove_if(Predicate pred)
+{
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
+    size_t removed = 0;
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->getSmallestNode());
+    while(node != nullptr) {
+        AVLNode<Key, Value>* next = static_cast<AVLNode<Key, Value>*>(this->successor(node));
+        if(pred(static_cast<const std::pair<const Key, Value>&>(node->getItem()))) {
+            removeNode(node);
+            ++removed;
+        }
+        node = next;
+    }
+    return removed;
+}
+
+/**
+* Returns this tree's own copy of node, whose key is key. Iterators into a
+* copy-on-write tree point at nodes it shares with its copies, and
+* unshare may replace them with private copies.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::ownNode(AVLNode<Key, Value>* node, const Key& key)
+{
+    //a count of 1 means no other copy holds the nodes, so unshare would keep them
+    if(this->shared_ == nullptr || this->shared_->load() == 1) {
+        return node;
+    }
+    const Key copy = key;
+    this->unshare();
+    return static_cast<AVLNode<Key, Value>*>(this->internalFind(copy));
+}
+
 template<class Key, class Value>
 void AVLTree<Key, Value>::nodeSwap(AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
 {
@@ -627,5 +950,163 @@ void AVLTree<Key, Value>::nodeSwap(AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n
     n2->setBalance(tempB);
 }
 
+/**
+* Writes the tree to out in the versioned binary format described by
+* AVLFileHeader. Key and Value must be trivially copyable.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::save(std::ostream& out) const
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "AVLTree::save requires trivially copyable Key and Value");
+
+    //count the entries first since the header carries the total
+    uint64_t count = 0;
+    for(typename AVLTree<Key, Value>::iterator it = this->begin(); it != this->end(); ++it){
+      ++count;
+    }
+
+    AVLFileHeader header;
+    std::memcpy(header.magic, AVL_FILE_MAGIC, sizeof(header.magic));
+    header.version = AVL_FILE_VERSION;
+    header.keySize = sizeof(Key);
+    header.valueSize = sizeof(Value);
+    header.count = count;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    //stage records in a large buffer and write it out in blocks
+    const size_t recordSize = sizeof(Key) + sizeof(Value);
+    std::vector<char> buffer;
+    buffer.reserve(std::max<size_t>(recordSize, (1 << 20) / recordSize * recordSize));
+    for(typename AVLTree<Key, Value>::iterator it = this->begin(); it != this->end(); ++it){
+      if(buffer.size() + recordSize > buffer.capacity()){
+        out.write(&buffer[0], buffer.size());
+        buffer.clear();
+      }
+      const char* key = reinterpret_cast<const char*>(&it->first);
+      const char* value = reinterpret_cast<const char*>(&it->second);
+      buffer.insert(buffer.end(), key, key + sizeof(Key));
+      buffer.insert(buffer.end(), value, value + sizeof(Value));
+    }
+    if(!buffer.empty()){
+      out.write(&buffer[0], buffer.size());
+    }
+    if(!out){
+      throw std::runtime_error("AVL file write failed");
+    }
+}
+
+/**
+* Replaces the contents of the tree with a file written by save. Since the
+* records are sorted, the tree is built directly in balanced shape in O(n)
+* with one comparison per record to check the order and no rotations.
+* Throws std::runtime_error if the file is not a valid save of this tree
+* type, in which case the tree keeps its old contents.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::load(std::istream& in)
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "AVLTree::load requires trivially copyable Key and Value");
+
+    AVLFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(in.gcount() != sizeof(header) or std::memcmp(header.magic, AVL_FILE_MAGIC, sizeof(header.magic)) != 0){
+      throw std::runtime_error("Not an AVL file");
+    }
+    if(header.version != AVL_FILE_VERSION){
+      throw std::runtime_error("Unsupported AVL file version");
+    }
+    if(header.keySize != sizeof(Key) or header.valueSize != sizeof(Value)){
+      throw std::runtime_error("AVL file key/value sizes do not match this tree");
+    }
+
+    AVLNode<Key, Value>* root = nullptr;
+    if(header.count != 0){
+      AVLBlockReader reader(in, sizeof(Key) + sizeof(Value), header.count);
+      int height = 0;
+      const Key* last = nullptr;
+      //the filter is refilled once the tree is whole, since allocateNode may rebuild it from the tree
+      KeyFilter* filter = this->filter_;
+      this->filter_ = nullptr;
+      try{
+        root = buildBalanced(static_cast<size_t>(header.count), reader, height, last);
+      }
+      catch(...){
+        this->filter_ = filter;
+        throw;
+      }
+      this->filter_ = filter;
+    }
+
+    //the old contents go only once the whole file has been read
+    this->clear();
+    this->root_ = root;
+    //gives the new nodes their own share count in copy-on-write mode
+    this->setCopyOnWrite(this->copyOnWrite_);
+    if(this->filter_ != nullptr){
+      this->rebuildFilter();
+    }
+}
+
+/**
+* Builds a balanced subtree from the next count records of reader, consuming
+* them in order: left half, then the subtree root, then the right half.
+* Sets height to the height of the built subtree. last points at the key of
+* the previous record, if any, and is moved to each new one; a key that is
+* not greater than it throws std::runtime_error.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::buildBalanced(size_t count, AVLBlockReader& reader, int& height, const Key*& last)
+{
+    if(count == 0){
+      height = 0;
+      return nullptr;
+    }
+    //the left half gets the extra record so balances are only ever 0 or -1
+    size_t rightCount = (count - 1) / 2;
+    int leftHeight = 0, rightHeight = 0;
+    AVLNode<Key,Value>* left = buildBalanced(count - 1 - rightCount, reader, leftHeight, last);
+
+    AVLNode<Key,Value>* node = nullptr;
+    try{
+      const char* record = reader.next();
+      typename std::aligned_storage<sizeof(Key), alignof(Key)>::type key;
+      typename std::aligned_storage<sizeof(Value), alignof(Value)>::type value;
+      std::memcpy(&key, record, sizeof(Key));
+      std::memcpy(&value, record + sizeof(Key), sizeof(Value));
+      if(last != nullptr and !(*last < *reinterpret_cast<Key*>(&key))){
+        throw std::runtime_error("AVL file keys are out of order");
+      }
+      node = this->allocateNode(*reinterpret_cast<Key*>(&key), *reinterpret_cast<Value*>(&value), static_cast<AVLNode<Key,Value>*>(nullptr));
+      last = &node->getKey();
+    }
+    catch(...){
+      this->postOrderDeletion(left);
+      throw;
+    }
+    node->setLeft(left);
+    if(left != nullptr){
+      left->setParent(node);
+    }
+
+    AVLNode<Key,Value>* right = nullptr;
+    try{
+      right = buildBalanced(rightCount, reader, rightHeight, last);
+    }
+    catch(...){
+      this->postOrderDeletion(node);
+      throw;
+    }
+    node->setRight(right);
+    if(right != nullptr){
+      right->setParent(node);
+    }
+
+    node->setBalance(static_cast<int8_t>(rightHeight - leftHeight));
+    height = 1 + std::max(leftHeight, rightHeight);
+    return node;
+}
+
 
 #endif
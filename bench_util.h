@@ -0,0 +1,223 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Shared helpers for the benchmark executable (bst-bench).
+
+typedef std::chrono::steady_clock Clock;
+
+// Seconds elapsed since start
+inline double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Nanoseconds elapsed since start
+inline uint64_t nanosSince(Clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+/**
+* Latencies of individually timed operations, in nanoseconds.
+*/
+class LatencySamples
+{
+public:
+    void add(uint64_t nanos) { samples_.push_back(nanos); }
+    void reserve(size_t n) { samples_.reserve(n); }
+    bool empty() const { return samples_.empty(); }
+
+    // Nearest-rank percentile, p in [0, 100]
+    uint64_t percentile(double p)
+    {
+        if(samples_.empty()) {
+            return 0;
+        }
+        std::sort(samples_.begin(), samples_.end());
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples_.size()));
+        return samples_[rank == 0 ? 0 : rank - 1];
+    }
+
+private:
+    std::vector<uint64_t> samples_;
+};
+
+/**
+* Results are printed as CSV, one row per measurement, so runs can be
+* diffed and loaded into regression tracking. Empty fields were not measured.
+*/
+inline void printReportHeader()
+{
+    printf("suite,structure,workload,n,op,seconds,ops_per_sec,p50_ns,p99_ns\n");
+}
+
+inline void report(const char* suite, const std::string& structure, const std::string& workload, size_t n,
+                   const char* op, double seconds, double ops, LatencySamples* latency = NULL)
+{
+    printf("%s,%s,%s,%zu,%s,%.6f,", suite, structure.c_str(), workload.c_str(), n, op, seconds);
+    if(ops > 0 && seconds > 0) {
+        printf("%.0f", ops / seconds);
+    }
+    if(latency != NULL && !latency->empty()) {
+        uint64_t p50 = latency->percentile(50);
+        uint64_t p99 = latency->percentile(99);
+        printf(",%llu,%llu\n", static_cast<unsigned long long>(p50), static_cast<unsigned long long>(p99));
+    }
+    else {
+        printf(",,\n");
+    }
+    fflush(stdout);
+}
+
+/**
+* One hardware event counter for the calling thread, user space only,
+* through perf_event_open. Where counters cannot be opened (not Linux, no
+* PMU in a VM, or perf_event_paranoid too strict) available() is false and
+* stop() returns 0, so callers can skip the numbers instead of failing.
+*/
+class PerfCounter
+{
+public:
+    PerfCounter(uint32_t type, uint64_t config) : fd_(-1)
+    {
+#ifdef __linux__
+        perf_event_attr attr = perf_event_attr();
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)type;
+        (void)config;
+#endif
+    }
+
+    ~PerfCounter()
+    {
+#ifdef __linux__
+        if(fd_ >= 0) {
+            close(fd_);
+        }
+#endif
+    }
+
+    bool available() const { return fd_ >= 0; }
+
+    void start()
+    {
+#ifdef __linux__
+        if(fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Events counted since start
+    uint64_t stop()
+    {
+        uint64_t count = 0;
+#ifdef __linux__
+        if(fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if(read(fd_, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+private:
+    PerfCounter(const PerfCounter&);
+    PerfCounter& operator=(const PerfCounter&);
+
+    int fd_;
+};
+
+/**
+* xorshift64*, a fast deterministic generator so every run sees the same keys.
+*/
+class BenchRandom
+{
+public:
+    explicit BenchRandom(uint64_t seed) : state_(seed ? seed : 88172645463325252ULL) {}
+
+    uint64_t next()
+    {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 2685821657736338717ULL;
+    }
+
+    // Uniform double in [0, 1)
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t state_;
+};
+
+/**
+* Returns n keys drawn from a distribution over a universe of n keys:
+*   sorted  - 0, 1, ..., n-1
+*   random  - a random permutation of 0..n-1
+*   zipf    - Zipfian (s = 0.99) over the universe, so a few keys repeat often;
+*             ranks are scattered over the key space so hot keys are not adjacent
+*   hotset  - 90% of keys drawn uniformly from a hot 1% of the universe, the
+*             rest uniformly from all of it; hot keys are scattered the same way
+*/
+inline std::vector<uint64_t> makeKeys(const std::string& distribution, size_t n, uint64_t seed = 1)
+{
+    std::vector<uint64_t> keys(n);
+    BenchRandom random(seed);
+    if(distribution == "zipf") {
+        std::vector<double> cdf(n);
+        double sum = 0;
+        for(size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+            cdf[i] = sum;
+        }
+        for(size_t i = 0; i < n; ++i) {
+            size_t rank = std::lower_bound(cdf.begin(), cdf.end(), random.unit() * sum) - cdf.begin();
+            keys[i] = (std::min(rank, n - 1) * 0x9E3779B97F4A7C15ULL) % n;
+        }
+        return keys;
+    }
+    if(distribution == "hotset") {
+        size_t hot = n / 100 > 0 ? n / 100 : 1;
+        for(size_t i = 0; i < n; ++i) {
+            size_t rank = random.unit() < 0.9 ? random.next() % hot : random.next() % n;
+            keys[i] = (rank * 0x9E3779B97F4A7C15ULL) % n;
+        }
+        return keys;
+    }
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    if(distribution == "random") {
+        for(size_t i = n; i > 1; --i) {
+            std::swap(keys[i - 1], keys[random.next() % i]);
+        }
+    }
+    return keys;
+}
+
+#endif
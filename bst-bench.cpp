@@ -0,0 +1,1251 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_util.h"
+#include "avlbst.h"
+#include "mapped_bst.h"
+#include "durable_avlbst.h"
+#include "splaybst.h"
+#include "rbbst.h"
+#include "augmented_avlbst.h"
+#include "interval_tree.h"
+#include "split_avlbst.h"
+#include "flat_combining.h"
+#include "concurrent_avlbst.h"
+#include "bst_latency.h"
+#include "bst_validate.h"
+#include "bst_profile.h"
+
+using namespace std;
+
+// Defined in equal-paths-bench.cpp, which cannot share a translation unit
+// with bst.h because both define a Node type.
+void benchEqualPaths(const vector<size_t>& sizes, unsigned reps);
+
+// The BinarySearchTree recursion is as deep as the tree, so sorted keys
+// (a linked list) are only benchmarked up to this size.
+static const size_t MAX_DEGENERATE_SIZE = 10000;
+
+/*
+  Adapters so one benchmark body covers the trees and std::map.
+*/
+template<class Tree>
+void benchInsert(Tree& tree, uint64_t key, uint64_t value) { tree.insert(make_pair(key, value)); }
+void benchInsert(map<uint64_t, uint64_t>& tree, uint64_t key, uint64_t value) { tree[key] = value; }
+
+template<class Tree>
+void benchRemove(Tree& tree, uint64_t key) { tree.remove(key); }
+void benchRemove(map<uint64_t, uint64_t>& tree, uint64_t key) { tree.erase(key); }
+
+template<class Tree>
+bool benchBalanced(const Tree& tree) { return tree.isBalanced(); }
+bool benchBalanced(const map<uint64_t, uint64_t>&) { return true; }
+
+template<class Tree>
+void fill(Tree& tree, const vector<uint64_t>& keys)
+{
+    for(size_t i = 0; i < keys.size(); ++i) {
+        benchInsert(tree, keys[i], i);
+    }
+}
+
+/**
+* Measures one structure on one key sequence. Mutating operations are run
+* twice on fresh structures: once untimed per operation for throughput, and
+* once with every operation timed for p50/p99, so the clock reads do not
+* skew the throughput numbers.
+*/
+template<class Tree>
+void benchStructure(const string& name, const string& workload, const vector<uint64_t>& keys,
+                    bool hasBalance, unsigned reps)
+{
+    const char* suite = "ops";
+    size_t n = keys.size();
+    LatencySamples latency;
+    latency.reserve(n);
+    Clock::time_point start;
+
+    // insert
+    Tree timed, untimed;
+    start = Clock::now();
+    fill(untimed, keys);
+    double insertSecs = secondsSince(start);
+    for(size_t i = 0; i < n; ++i) {
+        start = Clock::now();
+        benchInsert(timed, keys[i], i);
+        latency.add(nanosSince(start));
+    }
+    report(suite, name, workload, n, "insert", insertSecs, n, &latency);
+
+    // find, always hits
+    latency = LatencySamples();
+    size_t found = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < n; ++i) {
+        found += untimed.find(keys[i]) != untimed.end();
+    }
+    double findSecs = secondsSince(start);
+    for(size_t i = 0; i < n; ++i) {
+        start = Clock::now();
+        found += timed.find(keys[i]) != timed.end();
+        latency.add(nanosSince(start));
+    }
+    report(suite, name, workload, n, "find", findSecs, n, &latency);
+    if(found != 2 * n) {
+        fprintf(stderr, "%s: find missed keys\n", name.c_str());
+    }
+
+    // full in-order iteration, one sample per pass
+    latency = LatencySamples();
+    uint64_t sum = 0;
+    double iterateSecs = 0;
+    for(unsigned r = 0; r < reps; ++r) {
+        start = Clock::now();
+        for(typename Tree::iterator it = untimed.begin(); it != untimed.end(); ++it) {
+            sum += it->second;
+        }
+        uint64_t nanos = nanosSince(start);
+        iterateSecs += nanos / 1e9;
+        latency.add(nanos);
+    }
+    report(suite, name, workload, n, "iterate", iterateSecs, static_cast<double>(n) * reps, &latency);
+    if(sum == 1) {
+        fprintf(stderr, "unlikely checksum\n");
+    }
+
+    // isBalanced, one sample per call
+    if(hasBalance) {
+        latency = LatencySamples();
+        double balancedSecs = 0;
+        for(unsigned r = 0; r < reps; ++r) {
+            start = Clock::now();
+            benchBalanced(untimed);
+            uint64_t nanos = nanosSince(start);
+            balancedSecs += nanos / 1e9;
+            latency.add(nanos);
+        }
+        report(suite, name, workload, n, "isBalanced", balancedSecs, reps, &latency);
+    }
+
+    // remove every key (repeated keys in zipf workloads become misses)
+    latency = LatencySamples();
+    start = Clock::now();
+    for(size_t i = 0; i < n; ++i) {
+        benchRemove(untimed, keys[i]);
+    }
+    double removeSecs = secondsSince(start);
+    for(size_t i = 0; i < n; ++i) {
+        start = Clock::now();
+        benchRemove(timed, keys[i]);
+        latency.add(nanosSince(start));
+    }
+    report(suite, name, workload, n, "remove", removeSecs, n, &latency);
+
+    // clear of a full structure, one sample per call
+    latency = LatencySamples();
+    double clearSecs = 0;
+    for(unsigned r = 0; r < reps; ++r) {
+        fill(untimed, keys);
+        start = Clock::now();
+        untimed.clear();
+        uint64_t nanos = nanosSince(start);
+        clearSecs += nanos / 1e9;
+        latency.add(nanos);
+    }
+    report(suite, name, workload, n, "clear", clearSecs, reps, &latency);
+}
+
+// Every operation on each structure, key distribution and size
+static void benchOps(const vector<size_t>& sizes, unsigned reps)
+{
+    const char* distributions[] = { "sorted", "random", "zipf" };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        for(size_t d = 0; d < sizeof(distributions) / sizeof(distributions[0]); ++d) {
+            string workload = distributions[d];
+            vector<uint64_t> keys = makeKeys(workload, sizes[i]);
+            if(workload != "sorted" || sizes[i] <= MAX_DEGENERATE_SIZE) {
+                benchStructure<BinarySearchTree<uint64_t, uint64_t> >("bst", workload, keys, true, reps);
+            }
+            benchStructure<AVLTree<uint64_t, uint64_t> >("avl", workload, keys, true, reps);
+            benchStructure<RedBlackTree<uint64_t, uint64_t> >("rb", workload, keys, true, reps);
+            benchStructure<map<uint64_t, uint64_t> >("std::map", workload, keys, false, reps);
+        }
+    }
+}
+
+// Compares rebuilding an AVLTree with n inserts against save/load of a binary dump.
+static void benchLoad(const vector<size_t>& sizes)
+{
+    const char* path = "bst-bench.dump";
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        AVLTree<uint64_t, uint64_t> tree;
+
+        Clock::time_point start = Clock::now();
+        for(uint64_t k = 0; k < n; ++k) {
+            tree.insert(make_pair(2 * k, k));
+        }
+        report("load", "avl", "sorted", n, "insert", secondsSince(start), n);
+
+        ofstream out(path, ios::binary);
+        start = Clock::now();
+        tree.save(out);
+        out.close();
+        report("load", "avl", "sorted", n, "save", secondsSince(start), n);
+
+        tree.clear();
+        ifstream in(path, ios::binary);
+        start = Clock::now();
+        tree.load(in);
+        report("load", "avl", "sorted", n, "load", secondsSince(start), n);
+        remove(path);
+    }
+}
+
+// Compares opening a frozen mapped image against loading the binary dump, then
+// times lookups served straight from the mapping.
+static void benchMapped(const vector<size_t>& sizes)
+{
+    const char* dumpPath = "bst-bench.dump";
+    const char* imagePath = "bst-bench.image";
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            for(uint64_t k = 0; k < n; ++k) {
+                tree.insert(make_pair(2 * k, k));
+            }
+            ofstream out(dumpPath, ios::binary);
+            tree.save(out);
+            writeMappedTree(tree, imagePath);
+        }
+
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            ifstream in(dumpPath, ios::binary);
+            Clock::time_point start = Clock::now();
+            tree.load(in);
+            report("mapped", "avl", "sorted", n, "load", secondsSince(start), n);
+        }
+
+        Clock::time_point start = Clock::now();
+        MappedTreeView<uint64_t, uint64_t> view(imagePath);
+        report("mapped", "mapped-view", "sorted", n, "open", secondsSince(start), 1);
+
+        // half of the lookups miss since only even keys are stored
+        vector<uint64_t> keys = makeKeys("random", 2 * n);
+        keys.resize(n);
+        uint64_t found = 0;
+        start = Clock::now();
+        for(size_t j = 0; j < n; ++j) {
+            found += view.find(keys[j]) != view.end();
+        }
+        report("mapped", "mapped-view", "random", n, "find", secondsSince(start), n);
+        if(found > n) {
+            fprintf(stderr, "mapped view found too many keys\n");
+        }
+        remove(dumpPath);
+        remove(imagePath);
+    }
+}
+
+// Deletes the files in a store directory and the directory itself
+static void removeStore(const string& dir)
+{
+    DIR* d = opendir(dir.c_str());
+    if(d != NULL) {
+        for(struct dirent* entry = readdir(d); entry != NULL; entry = readdir(d)) {
+            if(entry->d_name[0] != '.') {
+                remove((dir + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+// Insert throughput of DurableAVLTree under each fsync batching policy
+static void benchDurable(const vector<size_t>& sizes)
+{
+    struct Policy { const char* name; DurabilityPolicy policy; unsigned threads; };
+    const Policy policies[] = {
+        { "sync-every-op",   DurabilityPolicy(1, 0, 0),    1 },
+        { "sync-every-op",   DurabilityPolicy(1, 0, 0),    4 },
+        { "sync-every-64",   DurabilityPolicy(64, 0, 0),   1 },
+        { "sync-every-1024", DurabilityPolicy(1024, 0, 0), 1 },
+        { "sync-every-10ms", DurabilityPolicy(0, 10, 0),   1 },
+        { "no-sync",         DurabilityPolicy(0, 0, 0),    1 },
+    };
+    const string dir = "bst-bench.store";
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        for(size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); ++p) {
+            size_t n = sizes[i];
+            unsigned threads = policies[p].threads;
+            removeStore(dir);
+            Clock::time_point start = Clock::now();
+            {
+                DurableAVLTree<uint64_t, uint64_t> store(dir, policies[p].policy);
+                vector<thread> workers;
+                for(unsigned t = 0; t < threads; ++t) {
+                    workers.push_back(thread([&store, n, t, threads]() {
+                        for(uint64_t k = t; k < n; k += threads) {
+                            store.insert(make_pair(k * 2654435761u % n, k));
+                        }
+                    }));
+                }
+                for(unsigned t = 0; t < threads; ++t) {
+                    workers[t].join();
+                }
+                store.sync();
+            }
+            string structure = string("durable-avl/") + policies[p].name + "/" + to_string(threads) + "t";
+            report("durable", structure, "hashed", n, "insert", secondsSince(start), n);
+        }
+    }
+    removeStore(dir);
+}
+
+static void printLatency(const string& name, const char* op, const LatencySummary& s)
+{
+    fprintf(stderr, "%s %s: count=%llu p50=%lluns p99=%lluns p999=%lluns max=%lluns\n", name.c_str(), op,
+            static_cast<unsigned long long>(s.count), static_cast<unsigned long long>(s.p50),
+            static_cast<unsigned long long>(s.p99), static_cast<unsigned long long>(s.p999),
+            static_cast<unsigned long long>(s.max));
+}
+
+/**
+* Overhead of LatencyTrackedTree. The untracked find runs on the same tree
+* through AVLTree::find, so both rows see the same node layout in memory.
+* Inserts build separate trees and carry some allocator noise. The recorded
+* quantiles are printed to stderr so stdout stays CSV.
+*/
+static void benchLatency(const vector<size_t>& sizes, unsigned reps)
+{
+    typedef AVLTree<uint64_t, uint64_t> Plain;
+    const unsigned periods[] = { 1, 16 };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        Clock::time_point start;
+        {
+            Plain plain;
+            start = Clock::now();
+            fill(plain, keys);
+            report("latency", "avl", "random", n, "insert", secondsSince(start), n);
+        }
+        for(size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); ++p) {
+            LatencyTrackedTree<uint64_t, uint64_t> tracked(periods[p]);
+            string name = "avl+latency/" + to_string(periods[p]);
+            start = Clock::now();
+            fill(tracked, keys);
+            report("latency", name, "random", n, "insert", secondsSince(start), n);
+
+            // one untimed pass so neither row pays for a cold cache
+            size_t found = 0;
+            for(size_t k = 0; k < n; ++k) {
+                found += tracked.Plain::find(keys[k]) != tracked.end();
+            }
+            found = 0;
+            start = Clock::now();
+            for(unsigned r = 0; r < reps; ++r) {
+                for(size_t k = 0; k < n; ++k) {
+                    found += tracked.Plain::find(keys[k]) != tracked.end();
+                }
+            }
+            report("latency", "avl", "random", n, "find", secondsSince(start), static_cast<double>(found));
+            found = 0;
+            start = Clock::now();
+            for(unsigned r = 0; r < reps; ++r) {
+                for(size_t k = 0; k < n; ++k) {
+                    found += tracked.find(keys[k]) != tracked.end();
+                }
+            }
+            report("latency", name, "random", n, "find", secondsSince(start), static_cast<double>(found));
+
+            tracked.clear();
+            printLatency(name, "insert", tracked.latency(LATENCY_INSERT));
+            printLatency(name, "find", tracked.latency(LATENCY_FIND));
+            printLatency(name, "clear", tracked.latency(LATENCY_CLEAR));
+        }
+    }
+}
+
+/**
+* Time the caller spends emptying an n-node AVLTree with clear, clearAsync
+* and clearIncremental. For the incremental mode, the inserts that pay for
+* the reclaiming are timed individually until all the old nodes are gone.
+*/
+static void benchTeardown(const vector<size_t>& sizes)
+{
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        Clock::time_point start;
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            fill(tree, keys);
+            start = Clock::now();
+            tree.clear();
+            report("teardown", "avl", "random", n, "clear", secondsSince(start), 1);
+        }
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            fill(tree, keys);
+            start = Clock::now();
+            tree.clearAsync();
+            report("teardown", "avl", "random", n, "clearAsync", secondsSince(start), 1);
+            start = Clock::now();
+            TreeReaper::instance().drain();
+            report("teardown", "avl", "random", n, "clearAsync-background", secondsSince(start), 1);
+        }
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            fill(tree, keys);
+            start = Clock::now();
+            tree.clearIncremental();
+            report("teardown", "avl", "random", n, "clearIncremental", secondsSince(start), 1);
+            LatencySamples latency;
+            size_t inserts = 0;
+            Clock::time_point total = Clock::now();
+            while(!tree.reclaim(0)) {
+                start = Clock::now();
+                tree.insert(make_pair(keys[inserts % n], inserts));
+                latency.add(nanosSince(start));
+                ++inserts;
+            }
+            report("teardown", "avl", "random", n, "insert-while-reclaiming", secondsSince(total), inserts, &latency);
+        }
+    }
+}
+
+// Full structural validation against the recursive verifyBalanced scan
+static void benchValidate(const vector<size_t>& sizes)
+{
+    const unsigned threadCounts[] = { 1, 2, 4, 8 };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        AVLTree<uint64_t, uint64_t> tree;
+        fill(tree, makeKeys("random", n));
+        Clock::time_point start = Clock::now();
+        bool balanced = tree.verifyBalanced();
+        report("validate", "avl", "random", n, "verifyBalanced", secondsSince(start), balanced ? n : 0);
+        for(size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t) {
+            start = Clock::now();
+            ValidationReport<uint64_t> result = validateTree(tree, threadCounts[t]);
+            string op = "validateTree/" + to_string(threadCounts[t]) + "t";
+            report("validate", "avl", "random", n, op.c_str(), secondsSince(start), result.valid ? result.nodes : 0);
+        }
+    }
+}
+
+/**
+* Shape profiles of a random-insert BST and AVLTree, printed to stderr, and
+* the time profileShape takes.
+*/
+static void benchProfile(const vector<size_t>& sizes)
+{
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        {
+            BinarySearchTree<uint64_t, uint64_t> tree;
+            fill(tree, keys);
+            Clock::time_point start = Clock::now();
+            ShapeProfile<uint64_t> profile = profileShape(tree);
+            report("profile", "bst", "random", n, "profileShape", secondsSince(start), profile.nodes);
+            fprintf(stderr, "bst, %zu random keys:\n", n);
+            printShapeProfile(cerr, profile);
+        }
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            fill(tree, keys);
+            Clock::time_point start = Clock::now();
+            ShapeProfile<uint64_t> profile = profileShape(tree);
+            report("profile", "avl", "random", n, "profileShape", secondsSince(start), profile.nodes);
+            fprintf(stderr, "avl, %zu random keys:\n", n);
+            printShapeProfile(cerr, profile);
+        }
+    }
+}
+
+// Times n finds of the keys in lookups
+template<class Tree>
+static void benchLookups(Tree& tree, const string& name, const string& workload, const vector<uint64_t>& lookups)
+{
+    size_t found = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < lookups.size(); ++i) {
+        found += tree.find(lookups[i]) != tree.end();
+    }
+    report("skewed", name, workload, lookups.size(), "find", secondsSince(start), found == lookups.size() ? found : 0);
+}
+
+/**
+* Lookups that mostly hit a few hot keys (Zipfian, and 90% of lookups on
+* 1% of the keys), against uniform lookups, on an AVLTree and on SplayTrees with several splay
+* periods. Every tree holds the same n random keys.
+*/
+static void benchSkewed(const vector<size_t>& sizes)
+{
+    const unsigned periods[] = { 1, 4, 16 };
+    const char* workloads[] = { "zipf", "hotset", "random" };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        for(size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+            vector<uint64_t> lookups = makeKeys(workloads[w], n, 2);
+            {
+                AVLTree<uint64_t, uint64_t> tree;
+                fill(tree, keys);
+                benchLookups(tree, "avl", workloads[w], lookups);
+            }
+            for(size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); ++p) {
+                SplayTree<uint64_t, uint64_t> tree(periods[p]);
+                fill(tree, keys);
+                benchLookups(tree, "splay/" + to_string(periods[p]), workloads[w], lookups);
+            }
+        }
+    }
+}
+
+/**
+* Runs n random inserts and removes, insertPercent of them inserts, on a
+* tree prefilled with n keys drawn from a universe of 2n. With BST_STATS
+* the rotations per operation go to stderr.
+*/
+template<class Tree>
+static void benchChurn(const string& name, size_t n, unsigned insertPercent)
+{
+    Tree tree;
+    BenchRandom random(3);
+    for(size_t i = 0; i < n; ++i) {
+        tree.insert(make_pair(random.next() % (2 * n), i));
+    }
+    vector<uint64_t> ops(n);
+    for(size_t i = 0; i < n; ++i) {
+        // the low bit picks the operation
+        uint64_t key = random.next() % (2 * n);
+        ops[i] = key << 1 | (random.next() % 100 < insertPercent ? 1 : 0);
+    }
+    tree.resetStats();
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < n; ++i) {
+        if(ops[i] & 1) {
+            tree.insert(make_pair(ops[i] >> 1, i));
+        }
+        else {
+            tree.remove(ops[i] >> 1);
+        }
+    }
+    string workload = "insert" + to_string(insertPercent);
+    report("churn", name, workload, n, "mixed", secondsSince(start), n);
+#ifdef BST_STATS
+    TreeStats stats = tree.stats();
+    fprintf(stderr, "%s %s: %.3f rotations per operation\n", name.c_str(), workload.c_str(),
+            static_cast<double>(stats.rotateLefts + stats.rotateRights) / n);
+#endif
+}
+
+// AVLTree against RedBlackTree from insert-heavy to remove-heavy mixes
+static void benchChurnMixes(const vector<size_t>& sizes)
+{
+    const unsigned insertPercents[] = { 75, 50, 25 };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        for(size_t p = 0; p < sizeof(insertPercents) / sizeof(insertPercents[0]); ++p) {
+            benchChurn<AVLTree<uint64_t, uint64_t> >("avl", sizes[i], insertPercents[p]);
+            benchChurn<RedBlackTree<uint64_t, uint64_t> >("rb", sizes[i], insertPercents[p]);
+        }
+    }
+}
+
+/**
+* Overlap queries on n random intervals of up to 1000 units with
+* IntervalTree::overlapping, against scanning every interval in order.
+*/
+static void benchIntervals(const vector<size_t>& sizes)
+{
+    const size_t queries = 1000;
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        uint64_t span = 1000 * n;
+        BenchRandom random(4);
+        IntervalTree<uint64_t, uint64_t> tree;
+        Clock::time_point start = Clock::now();
+        for(size_t k = 0; k < n; ++k) {
+            uint64_t begin = random.next() % span;
+            tree.insert(begin, begin + random.next() % 1000, k);
+        }
+        report("intervals", "interval", "random", n, "insert", secondsSince(start), n);
+
+        vector<uint64_t> lows(queries);
+        for(size_t q = 0; q < queries; ++q) {
+            lows[q] = random.next() % span;
+        }
+        size_t treeHits = 0;
+        start = Clock::now();
+        for(size_t q = 0; q < queries; ++q) {
+            tree.overlapping(lows[q], lows[q] + 10000, [&](const pair<const Interval<uint64_t>, uint64_t>&) {
+                ++treeHits;
+            });
+        }
+        report("intervals", "interval", "random", n, "overlapping", secondsSince(start), queries);
+
+        // the scan is O(n) per query, so only the first few queries are scanned
+        const size_t scanQueries = 10;
+        size_t scanHits = 0;
+        size_t checkHits = 0;
+        start = Clock::now();
+        for(size_t q = 0; q < scanQueries; ++q) {
+            uint64_t lo = lows[q];
+            uint64_t hi = lo + 10000;
+            for(IntervalTree<uint64_t, uint64_t>::iterator it = tree.begin(); it != tree.end(); ++it) {
+                if(hi < it->first.start) {
+                    break;
+                }
+                scanHits += !(it->first.end < lo);
+            }
+        }
+        report("intervals", "interval", "random", n, "scan-from-begin", secondsSince(start), scanQueries);
+        for(size_t q = 0; q < scanQueries; ++q) {
+            tree.overlapping(lows[q], lows[q] + 10000, [&](const pair<const Interval<uint64_t>, uint64_t>&) {
+                ++checkHits;
+            });
+        }
+        if(checkHits != scanHits) {
+            fprintf(stderr, "intervals: overlapping found %zu, scan found %zu\n", checkHits, scanHits);
+        }
+    }
+}
+
+/**
+* Sums of values over random key ranges holding about 1% of the keys, with
+* AugmentedAVLTree::aggregate against walking the range in a std::map. The
+* insert rows show what keeping the sums costs over a plain AVLTree.
+*/
+static void benchAggregate(const vector<size_t>& sizes)
+{
+    const size_t queries = 1000;
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        AVLTree<uint64_t, uint64_t> plain;
+        Clock::time_point start = Clock::now();
+        for(size_t k = 0; k < n; ++k) {
+            plain.insert(make_pair(keys[k], k));
+        }
+        report("aggregate", "avl", "random", n, "insert", secondsSince(start), n);
+
+        AugmentedAVLTree<uint64_t, uint64_t, SumMonoid<uint64_t, uint64_t> > tree;
+        start = Clock::now();
+        for(size_t k = 0; k < n; ++k) {
+            tree.insert(make_pair(keys[k], k));
+        }
+        report("aggregate", "sum-avl", "random", n, "insert", secondsSince(start), n);
+
+        map<uint64_t, uint64_t> reference;
+        for(size_t k = 0; k < n; ++k) {
+            reference[keys[k]] = k;
+        }
+        vector<uint64_t> sorted(keys);
+        sort(sorted.begin(), sorted.end());
+        BenchRandom random(5);
+        size_t width = max<size_t>(1, n / 100);
+        vector<pair<uint64_t, uint64_t> > ranges(queries);
+        for(size_t q = 0; q < queries; ++q) {
+            size_t first = random.next() % (n - width + 1);
+            ranges[q] = make_pair(sorted[first], sorted[first + width - 1]);
+        }
+
+        uint64_t treeTotal = 0;
+        start = Clock::now();
+        for(size_t q = 0; q < queries; ++q) {
+            treeTotal += tree.aggregate(ranges[q].first, ranges[q].second);
+        }
+        report("aggregate", "sum-avl", "random", n, "aggregate", secondsSince(start), queries);
+
+        uint64_t mapTotal = 0;
+        start = Clock::now();
+        for(size_t q = 0; q < queries; ++q) {
+            map<uint64_t, uint64_t>::const_iterator it = reference.lower_bound(ranges[q].first);
+            for( ; it != reference.end() && it->first <= ranges[q].second; ++it) {
+                mapTotal += it->second;
+            }
+        }
+        report("aggregate", "std::map", "random", n, "range-walk", secondsSince(start), queries);
+        if(treeTotal != mapTotal) {
+            fprintf(stderr, "aggregate: tree summed %llu, map summed %llu\n",
+                    (unsigned long long)treeTotal, (unsigned long long)mapTotal);
+        }
+    }
+}
+
+/**
+* A value of the size that makes split storage worthwhile.
+*/
+struct BenchPayload
+{
+    uint64_t words[32];
+
+    BenchPayload() : words() {}
+    explicit BenchPayload(uint64_t seed) : words() { words[0] = seed; }
+};
+
+ostream& operator<<(ostream& out, const BenchPayload& payload)
+{
+    return out << payload.words[0];
+}
+
+const BenchPayload* benchGet(const AVLTree<uint64_t, BenchPayload>& tree, uint64_t key)
+{
+    AVLTree<uint64_t, BenchPayload>::iterator it = tree.find(key);
+    return it == tree.end() ? NULL : &it->second;
+}
+const BenchPayload* benchGet(const SplitAVLTree<uint64_t, BenchPayload>& tree, uint64_t key)
+{
+    return tree.get(key);
+}
+
+/**
+* Random lookups reading one word of each value. Cache misses per lookup
+* go to stderr when hardware counters can be opened.
+*/
+template<class Tree>
+static void benchSplitLookups(const string& name, size_t n, const vector<uint64_t>& keys,
+                              const vector<uint64_t>& probes)
+{
+    Tree tree;
+    Clock::time_point start = Clock::now();
+    for(size_t k = 0; k < n; ++k) {
+        tree.insert(make_pair(keys[k], BenchPayload(keys[k])));
+    }
+    report("split", name, "random", n, "insert", secondsSince(start), n);
+
+    PerfCounter misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    PerfCounter l1Misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    uint64_t sum = 0;
+    misses.start();
+    l1Misses.start();
+    start = Clock::now();
+    for(size_t q = 0; q < probes.size(); ++q) {
+        const BenchPayload* payload = benchGet(tree, probes[q]);
+        sum += payload->words[0];
+    }
+    double seconds = secondsSince(start);
+    uint64_t l1 = l1Misses.stop();
+    uint64_t llc = misses.stop();
+    report("split", name, "random", n, "find", seconds, probes.size());
+    if(misses.available() || l1Misses.available()) {
+        fprintf(stderr, "%s, %zu keys: %.2f cache misses, %.2f L1d read misses per lookup\n", name.c_str(), n,
+                static_cast<double>(llc) / probes.size(), static_cast<double>(l1) / probes.size());
+    }
+    else {
+        fprintf(stderr, "%s: hardware counters unavailable, cache misses not measured\n", name.c_str());
+    }
+    if(sum == 0x9E3779B97F4A7C15ULL) {
+        fprintf(stderr, "unlikely checksum\n");
+    }
+}
+
+static void benchSplit(const vector<size_t>& sizes)
+{
+    const size_t probes = 1000000;
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        vector<uint64_t> order = makeKeys("random", probes, 2);
+        for(size_t q = 0; q < probes; ++q) {
+            order[q] = keys[order[q] % n];
+        }
+        benchSplitLookups<AVLTree<uint64_t, BenchPayload> >("avl-inline", n, keys, order);
+        benchSplitLookups<SplitAVLTree<uint64_t, BenchPayload> >("avl-split", n, keys, order);
+    }
+}
+
+/**
+* Deleting a contiguous range of a random-insert AVLTree three ways: remove
+* per key, erase(first, last) and remove_if over the whole tree.
+*/
+static void benchErase(const vector<size_t>& sizes)
+{
+    const unsigned percents[] = { 1, 50, 90 };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        for(size_t p = 0; p < sizeof(percents) / sizeof(percents[0]); ++p) {
+            uint64_t count = n * percents[p] / 100;
+            uint64_t lo = (n - count) / 2;
+            uint64_t hi = lo + count;
+            string workload = "range-" + to_string(percents[p]) + "%";
+            {
+                AVLTree<uint64_t, uint64_t> tree;
+                for(size_t k = 0; k < n; ++k) {
+                    tree.insert(make_pair(keys[k], k));
+                }
+                Clock::time_point start = Clock::now();
+                for(uint64_t key = lo; key < hi; ++key) {
+                    tree.remove(key);
+                }
+                report("erase", "avl", workload, n, "remove-per-key", secondsSince(start), count);
+            }
+            {
+                AVLTree<uint64_t, uint64_t> tree;
+                for(size_t k = 0; k < n; ++k) {
+                    tree.insert(make_pair(keys[k], k));
+                }
+                Clock::time_point start = Clock::now();
+                tree.erase(tree.find(lo), tree.find(hi));
+                report("erase", "avl", workload, n, "erase-range", secondsSince(start), count);
+            }
+            {
+                AVLTree<uint64_t, uint64_t> tree;
+                for(size_t k = 0; k < n; ++k) {
+                    tree.insert(make_pair(keys[k], k));
+                }
+                Clock::time_point start = Clock::now();
+                size_t removed = tree.remove_if([&](const pair<const uint64_t, uint64_t>& item) {
+                    return item.first >= lo && item.first < hi;
+                });
+                report("erase", "avl", workload, n, "remove_if", secondsSince(start), removed);
+            }
+        }
+    }
+}
+
+/**
+* find on an AVLTree of n even keys, with and without a find filter, where
+* missPercent of the lookups are for odd keys. The filter's size goes to
+* stderr, and with BST_STATS so does the share of lookups it answered.
+*/
+static void benchFilter(const vector<size_t>& sizes)
+{
+    const unsigned missPercents[] = { 100, 70, 0 };
+    const double rates[] = { 0, 0.01, 0.001 };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        for(size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+            string name = rates[r] == 0 ? string("avl") : "avl+filter/" + to_string(rates[r]).substr(0, 5);
+            AVLTree<uint64_t, uint64_t> tree;
+            if(rates[r] != 0) {
+                tree.enableFindFilter(rates[r]);
+            }
+            Clock::time_point start = Clock::now();
+            for(size_t k = 0; k < n; ++k) {
+                tree.insert(make_pair(2 * keys[k], keys[k]));
+            }
+            report("filter", name, "random", n, "insert", secondsSince(start), n);
+            for(size_t m = 0; m < sizeof(missPercents) / sizeof(missPercents[0]); ++m) {
+                BenchRandom random(m + 1);
+                vector<uint64_t> lookups(n);
+                for(size_t k = 0; k < n; ++k) {
+                    uint64_t key = 2 * (random.next() % n);
+                    lookups[k] = random.next() % 100 < missPercents[m] ? key + 1 : key;
+                }
+                size_t found = 0;
+                tree.resetStats();
+                start = Clock::now();
+                for(size_t k = 0; k < n; ++k) {
+                    found += tree.find(lookups[k]) != tree.end();
+                }
+                double secs = secondsSince(start);
+                string workload = "miss-" + to_string(missPercents[m]);
+                report("filter", name, workload, n, "find", secs, n);
+#ifdef BST_STATS
+                fprintf(stderr, "%s %s: %zu hits, %.4f of misses reached the tree\n", name.c_str(), workload.c_str(), found,
+                        n == found ? 0.0 : 1.0 - static_cast<double>(tree.stats().filterRejects) / (n - found));
+#else
+                fprintf(stderr, "%s %s: %zu hits\n", name.c_str(), workload.c_str(), found);
+#endif
+            }
+            //removing keys makes the filter rebuild every n/4 or so removes
+            start = Clock::now();
+            for(size_t k = 0; k < n; ++k) {
+                tree.remove(2 * keys[k]);
+                tree.insert(make_pair(2 * keys[k], keys[k]));
+            }
+            report("filter", name, "random", n, "remove+insert", secondsSince(start), 2 * n);
+            if(rates[r] != 0) {
+                fprintf(stderr, "%s: %.1f bits per key\n", name.c_str(), 8.0 * tree.findFilterBytes() / n);
+            }
+        }
+    }
+}
+
+/**
+* find on an AVLTree of n random keys, without and with find caches of a
+* few sizes, for Zipfian, hot-set and uniform lookups. Hit rates go to
+* stderr, and with BST_STATS so do key comparisons per find.
+*/
+static void benchCache(const vector<size_t>& sizes)
+{
+    const size_t entries[] = { 0, 1024, 16384 };
+    const char* workloads[] = { "zipf", "hotset", "random" };
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        size_t n = sizes[i];
+        vector<uint64_t> keys = makeKeys("random", n);
+        for(size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+            vector<uint64_t> lookups = makeKeys(workloads[w], n, 2);
+            for(size_t e = 0; e < sizeof(entries) / sizeof(entries[0]); ++e) {
+                AVLTree<uint64_t, uint64_t> tree;
+                fill(tree, keys);
+                string name = "avl";
+                if(entries[e] != 0) {
+                    tree.enableFindCache(entries[e]);
+                    name += "+cache/" + to_string(entries[e]);
+                }
+                tree.resetStats();
+                size_t found = 0;
+                Clock::time_point start = Clock::now();
+                for(size_t k = 0; k < lookups.size(); ++k) {
+                    found += tree.find(lookups[k]) != tree.end();
+                }
+                report("cache", name, workloads[w], n, "find", secondsSince(start), found == lookups.size() ? found : 0);
+                FindCacheStats cache = tree.findCacheStats();
+                fprintf(stderr, "%s %s: hit rate %.3f", name.c_str(), workloads[w],
+                        entries[e] == 0 ? 0.0 : static_cast<double>(cache.hits) / (cache.hits + cache.misses));
+#ifdef BST_STATS
+                fprintf(stderr, ", %.1f comparisons per find", static_cast<double>(tree.stats().comparisons) / lookups.size());
+#endif
+                fprintf(stderr, "\n");
+            }
+        }
+    }
+}
+
+/**
+* An AVLTree behind one std::mutex, the baseline for FlatCombiningTree and
+* ConcurrentAVLTree.
+*/
+class MutexAVLTree
+{
+public:
+    void insert(const pair<const uint64_t, uint64_t>& item)
+    {
+        lock_guard<mutex> lock(mutex_);
+        tree_.insert(item);
+    }
+    void remove(uint64_t key)
+    {
+        lock_guard<mutex> lock(mutex_);
+        tree_.remove(key);
+    }
+    bool find(uint64_t key, uint64_t& value)
+    {
+        lock_guard<mutex> lock(mutex_);
+        AVLTree<uint64_t, uint64_t>::iterator it = tree_.find(key);
+        if(it == tree_.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+private:
+    AVLTree<uint64_t, uint64_t> tree_;
+    mutex mutex_;
+};
+
+/**
+* threads writers share ops random inserts and removes (half each) on a
+* tree prefilled with n of 2n possible keys.
+*/
+template<class Tree>
+static void benchWriters(const string& name, size_t n, unsigned threads, size_t ops)
+{
+    Tree tree;
+    vector<uint64_t> keys = makeKeys("random", 2 * n);
+    for(size_t k = 0; k < n; ++k) {
+        tree.insert(make_pair(keys[k], k));
+    }
+    size_t perThread = ops / threads;
+    vector<thread> workers;
+    Clock::time_point start = Clock::now();
+    for(unsigned t = 0; t < threads; ++t) {
+        workers.push_back(thread([&tree, t, perThread, n]() {
+            BenchRandom random(t + 1);
+            for(size_t i = 0; i < perThread; ++i) {
+                uint64_t key = random.next() % (2 * n);
+                if(i % 2 == 0) {
+                    tree.insert(make_pair(key, i));
+                }
+                else {
+                    tree.remove(key);
+                }
+            }
+        }));
+    }
+    for(size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    string workload = "writers-" + to_string(threads) + "t";
+    report("combining", name, workload, n, "insert/remove", secondsSince(start), perThread * threads);
+}
+
+static void benchCombining(const vector<size_t>& sizes)
+{
+    const unsigned threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    const size_t ops = 1000000;
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        for(size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t) {
+            benchWriters<MutexAVLTree>("mutex-avl", sizes[i], threadCounts[t], ops);
+            benchWriters<FlatCombiningTree<uint64_t, uint64_t> >("combining-avl", sizes[i], threadCounts[t], ops);
+        }
+    }
+}
+
+/**
+* readers threads each look up lookups random keys on a tree of n even
+* keys, while one writer keeps inserting and removing odd keys until they
+* finish. Reports reader throughput; the writer's count goes to the
+* "writer" row. Correctness under this load is checked by the
+* ConcurrentAVL tests in tree-tests.
+*/
+template<class Tree>
+static void benchReaders(const string& name, size_t n, unsigned readers, size_t lookups)
+{
+    Tree tree;
+    for(size_t k = 0; k < n; ++k) {
+        tree.insert(make_pair(2 * k, 2 * k));
+    }
+    atomic<bool> stop(false);
+    size_t writes = 0;
+    thread writer([&tree, &stop, &writes, n]() {
+        BenchRandom random(0);
+        while(!stop.load(memory_order_relaxed)) {
+            uint64_t key = 2 * (random.next() % n) + 1;
+            if(writes % 2 == 0) {
+                tree.insert(make_pair(key, key));
+            }
+            else {
+                tree.remove(key);
+            }
+            ++writes;
+        }
+    });
+    vector<thread> workers;
+    Clock::time_point start = Clock::now();
+    for(unsigned t = 0; t < readers; ++t) {
+        workers.push_back(thread([&tree, t, n, lookups]() {
+            BenchRandom random(t + 1);
+            for(size_t i = 0; i < lookups; ++i) {
+                uint64_t key = 2 * (random.next() % n);
+                uint64_t value = 0;
+                tree.find(key, value);
+            }
+        }));
+    }
+    for(size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    double secs = secondsSince(start);
+    stop = true;
+    writer.join();
+    string workload = "readers-" + to_string(readers) + "t";
+    report("readers", name, workload, n, "find", secs, lookups * readers);
+    report("readers", name, workload, n, "writer", secs, writes);
+}
+
+static void benchReaderScaling(const vector<size_t>& sizes)
+{
+    const unsigned readerCounts[] = { 1, 2, 4, 8 };
+    const size_t lookups = 1000000;
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        for(size_t t = 0; t < sizeof(readerCounts) / sizeof(readerCounts[0]); ++t) {
+            benchReaders<MutexAVLTree>("mutex-avl", sizes[i], readerCounts[t], lookups);
+            benchReaders<ConcurrentAVLTree<uint64_t, uint64_t> >("concurrent-avl", sizes[i], readerCounts[t], lookups);
+        }
+    }
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr,
+            "usage: %s [suite] [sizes...]\n"
+            "  ops         insert/find/iterate/isBalanced/remove/clear on bst, avl, rb, std::map (default)\n"
+            "  equalpaths  equalPaths on perfect and random trees\n"
+            "  all         ops and equalpaths\n"
+            "  load        AVLTree save/load against rebuilding with insert\n"
+            "  mapped      MappedTreeView open and find\n"
+            "  durable     DurableAVLTree insert under each fsync policy\n"
+            "  latency     LatencyTrackedTree overhead against a plain AVLTree\n"
+            "  teardown    clear, clearAsync and clearIncremental on a large AVLTree\n"
+            "  validate    validateTree on 1-8 threads against verifyBalanced\n"
+            "  profile     profileShape on bst and avl; the profiles go to stderr\n"
+            "  skewed      SplayTree against AVLTree on Zipfian and uniform lookups\n"
+            "  churn       AVLTree against RedBlackTree on mixed inserts and removes;\n"
+            "              build with DEFS=-DBST_STATS to also get rotations per operation\n"
+            "  intervals   IntervalTree overlap queries against scanning from begin\n"
+            "  aggregate   AugmentedAVLTree range sums against walking a std::map range\n"
+            "  split       SplitAVLTree against inline AVLTree lookups with 256-byte values;\n"
+            "              cache misses per lookup go to stderr when perf counters are available\n"
+            "  erase       AVLTree range deletes: remove per key, erase(first, last) and remove_if\n"
+            "  filter      AVLTree find with and without a find filter at 100%%, 70%%, 0%% misses;\n"
+            "              build with DEFS=-DBST_STATS to also get the filter's false-positive rate\n"
+            "  cache       AVLTree find with and without a find cache on Zipfian, hot-set and uniform keys;\n"
+            "              build with DEFS=-DBST_STATS to also get comparisons per find\n"
+            "  combining   FlatCombiningTree against a mutex-wrapped AVLTree, 1 to 64 writer threads\n"
+            "  readers     ConcurrentAVLTree with 1 to 8 readers beside one writer\n"
+            "              against a mutex-wrapped AVLTree\n"
+            "Results are printed to stdout as CSV.\n", program);
+}
+
+int main(int argc, char *argv[])
+{
+    string suite = argc > 1 ? argv[1] : "ops";
+    vector<size_t> sizes;
+    for(int i = 2; i < argc; ++i) {
+        sizes.push_back(strtoull(argv[i], NULL, 10));
+    }
+    const unsigned reps = 5;
+
+    if(suite == "ops" || suite == "equalpaths" || suite == "all") {
+        if(sizes.empty()) {
+            sizes.push_back(1000);
+            sizes.push_back(100000);
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        if(suite != "equalpaths") {
+            benchOps(sizes, reps);
+        }
+        if(suite != "ops") {
+            benchEqualPaths(sizes, reps);
+        }
+    }
+    else if(suite == "load") {
+        if(sizes.empty()) {
+            sizes.push_back(10000000);
+            sizes.push_back(40000000);
+        }
+        printReportHeader();
+        benchLoad(sizes);
+    }
+    else if(suite == "mapped") {
+        if(sizes.empty()) {
+            sizes.push_back(10000000);
+        }
+        printReportHeader();
+        benchMapped(sizes);
+    }
+    else if(suite == "durable") {
+        if(sizes.empty()) {
+            sizes.push_back(20000);
+        }
+        printReportHeader();
+        benchDurable(sizes);
+    }
+    else if(suite == "latency") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchLatency(sizes, reps);
+    }
+    else if(suite == "teardown") {
+        if(sizes.empty()) {
+            sizes.push_back(5000000);
+        }
+        printReportHeader();
+        benchTeardown(sizes);
+    }
+    else if(suite == "validate") {
+        if(sizes.empty()) {
+            sizes.push_back(10000000);
+        }
+        printReportHeader();
+        benchValidate(sizes);
+    }
+    else if(suite == "profile") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchProfile(sizes);
+    }
+    else if(suite == "skewed") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchSkewed(sizes);
+    }
+    else if(suite == "churn") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchChurnMixes(sizes);
+    }
+    else if(suite == "intervals") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchIntervals(sizes);
+    }
+    else if(suite == "aggregate") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchAggregate(sizes);
+    }
+    else if(suite == "split") {
+        if(sizes.empty()) {
+            sizes.push_back(100000);
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchSplit(sizes);
+    }
+    else if(suite == "erase") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchErase(sizes);
+    }
+    else if(suite == "filter") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchFilter(sizes);
+    }
+    else if(suite == "cache") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchCache(sizes);
+    }
+    else if(suite == "combining") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchCombining(sizes);
+    }
+    else if(suite == "readers") {
+        if(sizes.empty()) {
+            sizes.push_back(1000000);
+        }
+        printReportHeader();
+        benchReaderScaling(sizes);
+    }
+    else {
+        usage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
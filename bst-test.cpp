@@ -41,8 +41,10 @@ int main(int argc, char *argv[])
     else {
         cout << "Did not find b" << endl;
     }
+    AVLTree<char,int> copy(at);
     cout << "Erasing b" << endl;
     at.remove('b');
+    cout << "Copy still has b: " << (copy.find('b') != copy.end()) << endl;
 
     return 0;
 }
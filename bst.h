@@ -5,6 +5,13 @@
 #include <exception>
 #include <cstdlib>
 #include <utility>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include "bst_stats.h"
+#include "bst_filter.h"
+#include "bst_cache.h"
+#include "bst_reaper.h"
 
 /**
  * A templated class for a Node in a search tree.
@@ -34,12 +41,17 @@ public:
     void setLeft(Node<Key, Value>* left);
     void setRight(Node<Key, Value>* right);
     void setValue(const Value &value);
+    int getHeight() const;
+    void setHeight(int height);
 
 protected:
     std::pair<const Key, Value> item_;
     Node<Key, Value>* parent_;
     Node<Key, Value>* left_;
     Node<Key, Value>* right_;
+    // Height of the subtree rooted here, a leaf is 1. Kept up to date by
+    // BinarySearchTree; AVLTree tracks balances instead and leaves it unused.
+    int height_;
 };
 
 /*
@@ -56,7 +68,8 @@ Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* par
     item_(key, value),
     parent_(parent),
     left_(NULL),
-    right_(NULL)
+    right_(NULL),
+    height_(1)
 {
 
 }
@@ -180,6 +193,24 @@ void Node<Key, Value>::setValue(const Value& value)
     item_.second = value;
 }
 
+/**
+* A getter for the height of the subtree rooted at this node.
+*/
+template<typename Key, typename Value>
+int Node<Key, Value>::getHeight() const
+{
+    return height_;
+}
+
+/**
+* A setter for the height of the subtree rooted at this node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setHeight(int height)
+{
+    height_ = height;
+}
+
 /*
   ---------------------------------------
   End implementations for the Node class.
@@ -194,16 +225,39 @@ class BinarySearchTree
 {
 public:
     BinarySearchTree(); //TODO
+    BinarySearchTree(const BinarySearchTree<Key, Value>& other);
     virtual ~BinarySearchTree(); //TODO
+    BinarySearchTree<Key, Value>& operator=(const BinarySearchTree<Key, Value>& other);
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
     void clear(); //TODO
-    bool isBalanced() const; //TODO
+    void clearAsync();
+    void clearIncremental();
+    bool reclaim(size_t maxSteps);
+    void setReclaimBudget(size_t maxSteps);
+    virtual bool isBalanced() const; //TODO
+    virtual int height() const;
+    bool verifyBalanced() const;
     void print() const;
     bool empty() const;
+    void setCopyOnWrite(bool enable);
+    void enableFindFilter(double falsePositiveRate = 0.01, double rebuildFraction = 0.25);
+    void disableFindFilter();
+    size_t findFilterBytes() const;
+    void enableFindCache(size_t entries = 4096);
+    void disableFindCache();
+    FindCacheStats findCacheStats() const;
+    TreeStats stats() const;
+    void resetStats();
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    template<typename MKey, typename MValue>
+    friend void writeMappedTree(const BinarySearchTree<MKey, MValue>& tree, const char* path);
+    template<typename VKey, typename VValue>
+    friend class TreeValidator;
+    template<typename SKey, typename SValue>
+    friend class ShapeProfiler;
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -228,8 +282,10 @@ public:
     };
 
 public:
+    iterator begin();
     iterator begin() const;
     iterator end() const;
+    iterator find(const Key& key);
     iterator find(const Key& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
@@ -247,15 +303,47 @@ protected:
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2);
 
     // Add helper functions here
-    //static Node<Key,Value>* successor(Node<Key, Value>* current);
+    static Node<Key, Value>* successor(Node<Key, Value>* current);
+    static Node<Key, Value>* iteratorNode(const iterator& it) { return it.current_; }
+    static iterator nodeIterator(Node<Key, Value>* node) { return iterator(node); }
     int getHeight(const Node<Key,Value>* node) const;
+    static int storedHeight(const Node<Key, Value>* node);
+    static bool isImbalanced(const Node<Key, Value>* node);
+    void fixHeightsUpward(Node<Key, Value>* child, Node<Key, Value>* parent, int oldHeight);
     void postOrderDeletion(Node<Key, Value>* node);
-    Node<Key, Value>* insertHelper(Node<Key, Value>* current, const std::pair<const Key, Value>& keyValuePair, Node<Key,Value>* parent);
+    virtual Node<Key, Value>* cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+    void copyFrom(const BinarySearchTree<Key, Value>& other);
+    void unshare();
+    Node<Key, Value>* detachRoot();
+    static bool teardown(Node<Key, Value>*& head, size_t maxSteps, const BinarySearchTree<Key, Value>* owner);
+    template<typename NodeType>
+    NodeType* allocateNode(const Key& key, const Value& value, NodeType* parent) const;
+    void freeNode(Node<Key, Value>* node) const;
+    void noteRemoval();
+    void rebuildFilter() const;
+    static uint64_t hashKey(const Key& key);
 
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    // Number of trees sharing root_, or NULL if this tree owns its nodes outright. Allocated by
+    // the tree itself before it gets its first node in copy-on-write mode, never by a copy of it
+    mutable std::atomic<int>* shared_;
+    bool copyOnWrite_;
+    // Number of nodes whose subtree heights differ by more than 1
+    size_t imbalanced_;
+    // Detached trees still to be freed by reclaim, chained through the top node's parent pointer
+    Node<Key, Value>* garbage_;
+    size_t reclaimBudget_;
+    // Membership filter consulted by internalFind, or NULL unless enableFindFilter was called
+    KeyFilter* filter_;
+    // Hot-key cache consulted by internalFind, or NULL unless enableFindCache was called
+    FindCache<Node<Key, Value> >* cache_;
+    // hashKey, once the filter or the cache needs it; a pointer so trees of unhashable keys still compile
+    uint64_t (*keyHash_)(const Key& key);
+#ifdef BST_STATS
+    mutable TreeStats stats_;
+#endif
 };
 
 /*
@@ -380,17 +468,48 @@ Begin implementations for the BinarySearchTree class.
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
 template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() : root_(nullptr) //initialize the root to nullptr
+BinarySearchTree<Key, Value>::BinarySearchTree() :
+    root_(nullptr), shared_(nullptr), copyOnWrite_(false), imbalanced_(0), garbage_(nullptr), reclaimBudget_(64),
+    filter_(nullptr), cache_(nullptr), keyHash_(nullptr) //initialize the root to nullptr
 {
     // TODO
   
 }
 
+/**
+* Copy constructor. Clones the shape of other in O(n) without any key comparisons,
+* or shares other's nodes if other is in copy-on-write mode.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>::BinarySearchTree(const BinarySearchTree<Key, Value>& other) :
+    root_(nullptr), shared_(nullptr), copyOnWrite_(false), imbalanced_(0), garbage_(nullptr), reclaimBudget_(64),
+    filter_(nullptr), cache_(nullptr), keyHash_(nullptr)
+{
+    copyFrom(other);
+}
+
+/**
+* Copy assignment, with the same sharing rules as the copy constructor.
+*/
+template<class Key, class Value>
+BinarySearchTree<Key, Value>&
+BinarySearchTree<Key, Value>::operator=(const BinarySearchTree<Key, Value>& other)
+{
+    if(this == &other) {
+        return *this;
+    }
+    clear();
+    copyFrom(other);
+    return *this;
+}
+
 template<typename Key, typename Value>
 BinarySearchTree<Key, Value>::~BinarySearchTree()
 {
     // TODO
     clear(); //use the clear function
+    delete filter_;
+    delete cache_;
 }
 
 /**
@@ -402,6 +521,139 @@ bool BinarySearchTree<Key, Value>::empty() const
     return root_ == NULL;
 }
 
+/**
+* Enables or disables copy-on-write. Copies made from a tree with copy-on-write
+* enabled share its nodes (O(1)) until either side is modified through insert,
+* remove, clear, the non-const operator[] or an iterator from the non-const
+* begin or find, at which point the writer takes a private O(n) clone.
+*
+* The share count is allocated here or with the first node, so copying a
+* shared tree only increments it and several threads may copy the same
+* const tree at once.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::setCopyOnWrite(bool enable)
+{
+    if(enable && root_ != nullptr && shared_ == nullptr) {
+        shared_ = new std::atomic<int>(1);
+    }
+    copyOnWrite_ = enable;
+}
+
+/**
+* Keeps a Bloom filter of the tree's keys in front of find, operator[] and
+* remove, so lookups of absent keys usually skip the tree walk. Absent keys
+* get through to the walk at about falsePositiveRate; present keys always
+* do. Removed keys stay in the filter until more than rebuildFraction of
+* the keys it holds are stale, when the next remove rebuilds it in O(n).
+* The filter is sized for twice the keys present at its last rebuild, and
+* rebuilt once that many are in, so it takes 1.44 * log2(1 / rate) to
+* twice that many bits per key (10-19 at 1%). Until it fills up its rate is
+* well under the configured one; full, blocking puts it slightly over
+* (1.2% at 1%, 0.16% at 0.1%). Costs a hash and one cache line per insert
+* and lookup. Needs std::hash<Key>. Throws std::invalid_argument unless
+* 0 < falsePositiveRate < 1 and rebuildFraction > 0.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::enableFindFilter(double falsePositiveRate, double rebuildFraction)
+{
+    if(!(falsePositiveRate > 0 && falsePositiveRate < 1) || !(rebuildFraction > 0)) {
+        throw std::invalid_argument("invalid find filter settings");
+    }
+    KeyFilter* filter = new KeyFilter(falsePositiveRate, rebuildFraction);
+    delete filter_;
+    filter_ = filter;
+    keyHash_ = &hashKey;
+    rebuildFilter();
+}
+
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::disableFindFilter()
+{
+    delete filter_;
+    filter_ = nullptr;
+}
+
+// Memory held by the find filter, 0 when there is none
+template<class Key, class Value>
+size_t BinarySearchTree<Key, Value>::findFilterBytes() const
+{
+    return filter_ == nullptr ? 0 : filter_->bytes();
+}
+
+/**
+* Keeps a set-associative cache of about entries recently found nodes in
+* front of find, operator[] and remove, so a hot key costs one hash, one
+* probe of a set and one node access instead of a walk from the root.
+* Entries are dropped as their nodes are freed, and all of them on clear
+* and when a copy-on-write tree takes its private copy. Rotations and
+* nodeSwap relink nodes without moving keys between them, so they leave
+* entries valid. Needs std::hash<Key>.
+*
+* With the cache on, lookups write to it, so even const lookups on a tree
+* shared between threads need a lock.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::enableFindCache(size_t entries)
+{
+    FindCache<Node<Key, Value> >* cache = new FindCache<Node<Key, Value> >(entries);
+    delete cache_;
+    cache_ = cache;
+    keyHash_ = &hashKey;
+}
+
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::disableFindCache()
+{
+    delete cache_;
+    cache_ = nullptr;
+}
+
+// Hits and misses since the cache was enabled, or zeros when there is none
+template<class Key, class Value>
+FindCacheStats BinarySearchTree<Key, Value>::findCacheStats() const
+{
+    return cache_ == nullptr ? FindCacheStats() : cache_->stats();
+}
+
+/**
+* std::hash spread over all 64 bits with splitmix64's finalizer, since
+* std::hash is the identity for integers and the filter and the cache
+* index by the low bits.
+*/
+template<class Key, class Value>
+uint64_t BinarySearchTree<Key, Value>::hashKey(const Key& key)
+{
+    uint64_t h = std::hash<Key>()(key);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+* Returns a snapshot of the operation counters (all zero unless built with BST_STATS).
+*/
+template<class Key, class Value>
+TreeStats BinarySearchTree<Key, Value>::stats() const
+{
+#ifdef BST_STATS
+    return stats_;
+#else
+    return TreeStats();
+#endif
+}
+
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::resetStats()
+{
+#ifdef BST_STATS
+    stats_ = TreeStats();
+#endif
+}
+
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::print() const
 {
@@ -409,6 +661,18 @@ void BinarySearchTree<Key, Value>::print() const
     std::cout << "\n";
 }
 
+/**
+* Returns an iterator to the "smallest" item in the tree. Values may be
+* written through it, so a copy-on-write tree first takes its own nodes.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::begin()
+{
+    unshare();
+    return static_cast<const BinarySearchTree<Key, Value>*>(this)->begin();
+}
+
 /**
 * Returns an iterator to the "smallest" item in the tree
 */
@@ -431,6 +695,18 @@ BinarySearchTree<Key, Value>::end() const
     return end;
 }
 
+/**
+* Like the const find, but values may be written through the iterator, so
+* a copy-on-write tree first takes its own nodes.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::find(const Key & k)
+{
+    unshare();
+    return static_cast<const BinarySearchTree<Key, Value>*>(this)->find(k);
+}
+
 /**
 * Returns an iterator to the item with the given key, k
 * or the end iterator if k does not exist in the tree
@@ -451,6 +727,7 @@ BinarySearchTree<Key, Value>::find(const Key & k) const
 template<class Key, class Value>
 Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
 {
+    unshare();
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
@@ -470,37 +747,43 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 * overwrite the current value with the updated value.
 */
 template<class Key, class Value>
-Node<Key, Value>* BinarySearchTree<Key,Value>::insertHelper(Node<Key, Value>* current, const std::pair<const Key, Value>& keyValuePair, Node<Key,Value>* parent){
-    //if the node is a nullptr
-    if(current == nullptr) { 
-      //insert the new node with the proper information
-        Node<Key, Value>* newNode = new Node<Key,Value>(keyValuePair.first, keyValuePair.second, parent);
-        //and return that node
-        return newNode; 
+void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair) {
+    unshare();
+    reclaim(reclaimBudget_);
+    //walk down to the insertion point, overwriting the value if the key is already present
+    Node<Key, Value>* current = root_;
+    Node<Key, Value>* parent = nullptr;
+    bool goLeft = false;
+    while(current != nullptr) {
+        parent = current;
+        BST_STAT_ADD(comparisons, 1);
+        if(keyValuePair.first < current->getKey()) {
+            goLeft = true;
+            current = current->getLeft();
+        }
+        else if(BST_STAT_ADD(comparisons, 1), keyValuePair.first > current->getKey()) {
+            goLeft = false;
+            current = current->getRight();
+        }
+        //if equal, change the value at that key
+        else {
+            current->setValue(keyValuePair.second);
+            return;
+        }
     }
-    //if the key is less than the current node, go to the left
-    if (keyValuePair.first < current->getKey()) {
-      //recursive call
-        current->setLeft(insertHelper(current->getLeft(), keyValuePair, current));
+
+    //insert the new node with the proper information
+    Node<Key, Value>* newNode = allocateNode(keyValuePair.first, keyValuePair.second, parent);
+    if(parent == nullptr) {
+        root_ = newNode;
     }
-    //if key is greater go to the right
-    else if (keyValuePair.first > current->getKey()){
-        current->setRight(insertHelper(current->getRight(), keyValuePair, current));
+    else if(goLeft) {
+        parent->setLeft(newNode);
     }
-    //if equal, change the value at that key
-    else{
-      current->setValue(keyValuePair.second);
+    else {
+        parent->setRight(newNode);
     }
-
-    //return the current node
-    return current; 
-}
-
-
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair) {
-  //recursively call insertHelper. have the current node as root, and the parent as nullptr
-    root_ = insertHelper(root_, keyValuePair, nullptr);
+    fixHeightsUpward(newNode, parent, 0);
 }
 
 
@@ -512,6 +795,8 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key)
 {    
+    unshare();
+    reclaim(reclaimBudget_);
     //find the node you need to remove 
     Node<Key,Value>* removeNode = internalFind(key);
 
@@ -530,6 +815,14 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             nodeSwap(removeNode, pred);
         }
     }
+
+    //removeNode now has at most one child, which takes its place
+    Node<Key, Value>* oldParent = removeNode->getParent();
+    Node<Key, Value>* replacement = removeNode->getLeft() != nullptr ? removeNode->getLeft() : removeNode->getRight();
+    int oldHeight = removeNode->getHeight();
+    if(isImbalanced(removeNode)) {
+        --imbalanced_;
+    }
       
 
     // Handle the case when the node to be removed has no children 
@@ -602,8 +895,11 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         } 
     }
     
+    fixHeightsUpward(replacement, oldParent, oldHeight);
+
     //delete the node and return 
-    delete removeNode; 
+    freeNode(removeNode); 
+    noteRemoval();
     return;
 }
 
@@ -641,6 +937,32 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
     return nullptr; 
 }
 
+/**
+* Returns the next node in key order, or NULL if current is the last.
+*/
+template<class Key, class Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+{
+    if(current == nullptr) {
+        return nullptr;
+    }
+    //the left most node of the right subtree
+    if(current->getRight() != nullptr) {
+        current = current->getRight();
+        while(current->getLeft() != nullptr) {
+            current = current->getLeft();
+        }
+        return current;
+    }
+    //or the first ancestor whose left subtree holds current
+    Node<Key, Value>* parent = current->getParent();
+    while(parent != nullptr && parent->getRight() == current) {
+        current = parent;
+        parent = parent->getParent();
+    }
+    return parent;
+}
 
 
 template<typename Key, typename Value>
@@ -651,23 +973,324 @@ void BinarySearchTree<Key, Value>::postOrderDeletion(Node<Key,Value>* node) {
     }
     postOrderDeletion(node->getLeft()); 
     postOrderDeletion(node->getRight());
-    delete node; 
+    freeNode(node); 
+}
+
+/**
+* Allocates a node of the tree's node type. Every node a tree owns is
+* created here and released through freeNode, so per-node bookkeeping
+* (such as the BST_STATS counters) has a single place to live.
+*/
+template<typename Key, typename Value>
+template<typename NodeType>
+NodeType* BinarySearchTree<Key, Value>::allocateNode(const Key& key, const Value& value, NodeType* parent) const
+{
+    BST_STAT_ADD(allocations, 1);
+    //copies share through this count, so it must exist before they can be made
+    if(copyOnWrite_ && shared_ == nullptr) {
+        shared_ = new std::atomic<int>(1);
+    }
+    NodeType* node = new NodeType(key, value, parent);
+    if(filter_ != nullptr) {
+        //every caller is about to link a new key into a consistent tree, so the filter can be refilled from it here
+        if(filter_->needsRebuild()) {
+            rebuildFilter();
+        }
+        filter_->add(keyHash_(key));
+    }
+    return node;
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::freeNode(Node<Key, Value>* node) const
+{
+    BST_STAT_ADD(frees, 1);
+    if(cache_ != nullptr) {
+        cache_->erase(keyHash_(node->getKey()), node);
+    }
+    delete node;
+}
+
+/**
+* Tells the find filter, if any, that a key has left the tree, and
+* rebuilds it once too many of its keys are stale. Called by each remove
+* once the tree is consistent again.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::noteRemoval()
+{
+    if(filter_ == nullptr) {
+        return;
+    }
+    filter_->noteRemoved();
+    if(filter_->needsRebuild()) {
+        rebuildFilter();
+    }
+}
+
+/**
+* Refills the find filter from the keys in the tree, sized for twice as
+* many so the tree can double before the next rebuild. Since rebuilds
+* happen when the key count doubles or a fraction of it is removed, they
+* cost O(1) amortized per insert and remove.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuildFilter() const
+{
+    size_t count = 0;
+    for(Node<Key, Value>* node = getSmallestNode(); node != nullptr; node = successor(node)) {
+        ++count;
+    }
+    filter_->reset(2 * count);
+    for(Node<Key, Value>* node = getSmallestNode(); node != nullptr; node = successor(node)) {
+        filter_->add(keyHash_(node->getKey()));
+    }
 }
 
 /**
 * A method to remove all contents of the tree and
 * reset the values in the tree for use again.
+* Trees left behind by clearIncremental are freed as well.
 */
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::clear()
 {
     // TODO
     //call post order deletion and then set the root to null
-    postOrderDeletion(root_); 
-    root_ = nullptr; 
+    postOrderDeletion(detachRoot()); 
+    teardown(garbage_, static_cast<size_t>(-1), this);
     return; 
 }
 
+/**
+* Empties the tree in O(1) and frees the old nodes on the TreeReaper's
+* background thread, so dropping a huge tree does not stall the caller.
+* Nodes freed this way are not counted in the BST_STATS frees counter.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::clearAsync()
+{
+    Node<Key, Value>* old = detachRoot();
+    if(old == nullptr) {
+        return;
+    }
+    TreeReaper::instance().submit([old]() {
+        Node<Key, Value>* head = old;
+        teardown(head, static_cast<size_t>(-1), nullptr);
+    });
+}
+
+/**
+* Empties the tree in O(1) and leaves the old nodes to be freed a few at a
+* time: every later insert and remove spends up to the reclaim budget
+* (see setReclaimBudget) on them, so no single operation pays for the whole
+* tree. Call reclaim to free more at a convenient time.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::clearIncremental()
+{
+    Node<Key, Value>* old = detachRoot();
+    if(old == nullptr) {
+        return;
+    }
+    old->setParent(garbage_);
+    garbage_ = old;
+}
+
+/**
+* Frees nodes left by clearIncremental, doing at most maxSteps steps of
+* O(1) work each (a node freed or a rotation). Each rotation lifts one
+* node onto the right spine of the top tree, where it stays until it is
+* freed, so freeing n nodes takes at most 2n steps in total. A single call may free nothing, though: it can spend all of
+* its steps rotating a left spine longer than maxSteps. Returns true once
+* nothing is left to free.
+*/
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::reclaim(size_t maxSteps)
+{
+    if(garbage_ == nullptr) {
+        return true;
+    }
+    return teardown(garbage_, maxSteps, this);
+}
+
+/**
+* Sets how many reclaim steps each insert and remove spends on nodes left
+* by clearIncremental (64 by default). 0 leaves them to explicit reclaim
+* calls, clear and the destructor.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setReclaimBudget(size_t maxSteps)
+{
+    reclaimBudget_ = maxSteps;
+}
+
+/**
+* Empties the tree and returns the nodes it must free, or NULL when there are
+* none or other copy-on-write copies still hold them.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::detachRoot()
+{
+    Node<Key, Value>* old = root_;
+    root_ = nullptr;
+    imbalanced_ = 0;
+    if(filter_ != nullptr) {
+        filter_->reset(0);
+    }
+    if(cache_ != nullptr) {
+        cache_->clear();
+    }
+    //if the nodes are shared, only the last tree to let go of them deletes them
+    if(shared_ != nullptr) {
+        if(--(*shared_) != 0) {
+            old = nullptr;
+        }
+        else {
+            delete shared_;
+        }
+        shared_ = nullptr;
+    }
+    return old;
+}
+
+/**
+* Frees up to maxSteps steps' worth of the trees chained from head without
+* recursion or extra memory. While the top node has a left child it is
+* rotated right; otherwise it is freed and its right child takes its place.
+* Each top node's parent pointer links to the next detached tree. Nodes
+* are freed through owner, or deleted directly if owner is NULL.
+* Returns true once head is empty.
+*/
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::teardown(Node<Key, Value>*& head, size_t maxSteps,
+                                            const BinarySearchTree<Key, Value>* owner)
+{
+    for(size_t steps = 0; head != nullptr && steps < maxSteps; ++steps) {
+        Node<Key, Value>* left = head->getLeft();
+        if(left != nullptr) {
+            head->setLeft(left->getRight());
+            left->setRight(head);
+            left->setParent(head->getParent());
+            head = left;
+            continue;
+        }
+        Node<Key, Value>* next = head->getRight();
+        if(next != nullptr) {
+            next->setParent(head->getParent());
+        }
+        else {
+            next = head->getParent();
+        }
+        if(owner != nullptr) {
+            owner->freeNode(head);
+        }
+        else {
+            delete head;
+        }
+        head = next;
+    }
+    return head == nullptr;
+}
+
+/**
+* Makes this (empty) tree a copy of other: an O(n) structural clone,
+* or a shared reference to other's nodes in copy-on-write mode.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::copyFrom(const BinarySearchTree<Key, Value>& other)
+{
+    copyOnWrite_ = other.copyOnWrite_;
+    imbalanced_ = other.imbalanced_;
+    //the filter is copied as a whole below rather than refilled while cloning
+    delete filter_;
+    filter_ = nullptr;
+    delete cache_;
+    cache_ = nullptr;
+    if(other.root_ != nullptr) {
+        //other allocated the count along with its nodes; only the count itself is written here
+        if(copyOnWrite_ && other.shared_ != nullptr) {
+            ++(*other.shared_);
+            shared_ = other.shared_;
+            root_ = other.root_;
+        }
+        else {
+            root_ = cloneTree(other.root_, nullptr);
+        }
+    }
+    if(other.filter_ != nullptr) {
+        filter_ = new KeyFilter(*other.filter_);
+    }
+    //a copy starts with an empty cache of the same size, since cloned nodes have new addresses
+    if(other.cache_ != nullptr) {
+        cache_ = new FindCache<Node<Key, Value> >(other.cache_->capacity());
+    }
+    keyHash_ = other.keyHash_;
+}
+
+/**
+* Gives this tree a private copy of its nodes before a write if they are
+* currently shared with other copy-on-write copies.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::unshare()
+{
+    if(shared_ == nullptr) {
+        return;
+    }
+    //the count can only grow by copying this tree, so 1 means nobody else holds the nodes
+    if(shared_->load() == 1) {
+        if(!copyOnWrite_) {
+            delete shared_;
+            shared_ = nullptr;
+        }
+        return;
+    }
+    //the private copy gets a count of its own if it can still be shared
+    std::atomic<int>* count = copyOnWrite_ ? new std::atomic<int>(1) : nullptr;
+    //the clone holds the same keys, so it must not add them to the filter again
+    KeyFilter* filter = filter_;
+    filter_ = nullptr;
+    Node<Key, Value>* copy;
+    try {
+        copy = cloneTree(root_, nullptr);
+    }
+    catch(...) {
+        filter_ = filter;
+        delete count;
+        throw;
+    }
+    filter_ = filter;
+    //cached nodes are the shared ones, which this tree no longer uses
+    if(cache_ != nullptr) {
+        cache_->clear();
+    }
+    //another holder may have let go while we were cloning
+    if(--(*shared_) == 0) {
+        delete shared_;
+        postOrderDeletion(root_);
+    }
+    shared_ = count;
+    root_ = copy;
+}
+
+/**
+* Recursively copies the subtree at src, attaching the copy to parent.
+* Runs in O(n) and performs no key comparisons.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    if(src == nullptr) {
+        return nullptr;
+    }
+    Node<Key, Value>* copy = allocateNode(src->getKey(), src->getValue(), parent);
+    copy->setHeight(src->getHeight());
+    copy->setLeft(cloneTree(src->getLeft(), copy));
+    copy->setRight(cloneTree(src->getRight(), copy));
+    return copy;
+}
+
 
 /**
 * A helper function to find the smallest node in the tree.
@@ -679,7 +1302,7 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
     // TODO
     //go to the left most node in the BST
     Node<Key,Value>* smallestNode = root_; 
-    while (smallestNode->getLeft() != nullptr and smallestNode != nullptr) {
+    while (smallestNode != nullptr and smallestNode->getLeft() != nullptr) {
         smallestNode = smallestNode->getLeft(); 
     }
     return smallestNode; 
@@ -694,16 +1317,36 @@ template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
 {
     // TODO 
+    uint64_t hash = 0;
+    if(filter_ != nullptr || cache_ != nullptr) {
+        hash = keyHash_(key);
+    }
+    //hot keys are answered by the cache with a single node access
+    if(cache_ != nullptr) {
+        Node<Key, Value>* cached = cache_->find(hash, [&key](const Node<Key, Value>* node) { return node->getKey() == key; });
+        if(cached != nullptr) {
+            return cached;
+        }
+    }
+    //the filter rules out most absent keys without touching the tree
+    if(filter_ != nullptr && !filter_->mightContain(hash)) {
+        BST_STAT_ADD(filterRejects, 1);
+        return nullptr;
+    }
     //initially start at the root of the BST 
     Node<Key,Value>* current = root_; 
     //while current is not null
     while (current != nullptr) {
       //if the key is correct, return the current node
+        BST_STAT_ADD(comparisons, 1);
         if(current->getKey() == key) {
+            if(cache_ != nullptr) {
+                cache_->insert(hash, current);
+            }
             return current; 
         }
         //otherwise, the current key is less than the parameter key, go to the right subtree
-        else if (current->getKey() < key){
+        else if (BST_STAT_ADD(comparisons, 1), current->getKey() < key){
             current = current->getRight(); 
         }
         //otherwise go left
@@ -723,48 +1366,96 @@ int BinarySearchTree<Key, Value>::getHeight(const Node<Key,Value>* node) const {
         return 0; 
     }
     
-    //get the height of left and right subtree 
+    //get the height of left and right subtree, giving up as soon as either is unbalanced
     int leftHeight = getHeight(node->getLeft()); 
+    if(leftHeight == -1) {
+        return -1;
+    }
     int rightHeight = getHeight(node->getRight()); 
+    if(rightHeight == -1) {
+        return -1; 
+    }
 
     //return -1 if not balanced 
     if(abs(leftHeight - rightHeight) > 1){
         return -1;
     }
-    if(rightHeight == -1 or leftHeight == -1) {
-        return -1; 
-    }
     //return the max of both heights 
     return std::max(leftHeight, rightHeight) + 1;
 }
 
 /**
  * Return true iff the BST is balanced.
+ * Runs in O(1) from the count of imbalanced nodes kept by insert and remove.
  */
 template<typename Key, typename Value>
 bool BinarySearchTree<Key, Value>::isBalanced() const
 {
     // TODO
-    if(root_ == nullptr) {
-        return true; 
-    }
+    return imbalanced_ == 0; 
+}
 
-    //get the left and right heights 
-    int leftHeight = getHeight(root_->getLeft());
-    int rightHeight = getHeight(root_->getRight()); 
+/**
+ * Returns the height of the tree (0 when empty) in O(1).
+ */
+template<typename Key, typename Value>
+int BinarySearchTree<Key, Value>::height() const
+{
+    return storedHeight(root_);
+}
 
-    //not balanced if the heights are different 
-    if(rightHeight == -1 or leftHeight == -1){
-        return false;
-    }
-    if(std::abs(leftHeight - rightHeight) > 1){
-        return false; 
-    }
+/**
+ * Recomputes balance from scratch without trusting the stored heights,
+ * stopping at the first imbalanced subtree.
+ */
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::verifyBalanced() const
+{
+    return getHeight(root_) != -1;
+}
 
-    //otherwise return true 
-    return true; 
+template<typename Key, typename Value>
+int BinarySearchTree<Key, Value>::storedHeight(const Node<Key, Value>* node)
+{
+    return node == nullptr ? 0 : node->getHeight();
 }
 
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::isImbalanced(const Node<Key, Value>* node)
+{
+    return std::abs(storedHeight(node->getLeft()) - storedHeight(node->getRight())) > 1;
+}
+
+/**
+ * Called after the subtree under parent on child's side changed height from
+ * oldHeight (child may be NULL if that side is now empty). Updates heights
+ * and the imbalance count on the way up, and stops at the first ancestor
+ * whose height did not change.
+ */
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::fixHeightsUpward(Node<Key, Value>* child, Node<Key, Value>* parent, int oldHeight)
+{
+    int newHeight = storedHeight(child);
+    while(parent != nullptr && oldHeight != newHeight) {
+        Node<Key, Value>* sibling = parent->getLeft() == child ? parent->getRight() : parent->getLeft();
+        int siblingHeight = storedHeight(sibling);
+        bool wasImbalanced = std::abs(oldHeight - siblingHeight) > 1;
+        bool nowImbalanced = std::abs(newHeight - siblingHeight) > 1;
+        if(wasImbalanced != nowImbalanced) {
+            if(nowImbalanced) {
+                ++imbalanced_;
+            }
+            else {
+                --imbalanced_;
+            }
+        }
+        oldHeight = parent->getHeight();
+        newHeight = 1 + std::max(newHeight, siblingHeight);
+        parent->setHeight(newHeight);
+        child = parent;
+        parent = parent->getParent();
+    }
+}
 
 
 template<typename Key, typename Value>
@@ -773,6 +1464,11 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
+    BST_STAT_ADD(nodeSwaps, 1);
+    //heights belong to positions in the tree, so they trade places too
+    int height = n1->getHeight();
+    n1->setHeight(n2->getHeight());
+    n2->setHeight(height);
     Node<Key, Value>* n1p = n1->getParent();
     Node<Key, Value>* n1r = n1->getRight();
     Node<Key, Value>* n1lt = n1->getLeft();
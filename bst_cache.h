@@ -0,0 +1,137 @@
+#ifndef BST_CACHE_H
+#define BST_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+* Hit and miss counts of a tree's find cache.
+*/
+struct FindCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+
+    FindCacheStats() : hits(0), misses(0) {}
+};
+
+/**
+* A small set-associative cache from key hash to node, kept by
+* BinarySearchTree::enableFindCache so repeated lookups of hot keys cost
+* one probe and one node access instead of a walk from the root.
+*
+* Hashes must be well mixed: the low bits pick the set. Each set holds
+* WAYS entries, most recently used first, with the top 32 bits of the hash
+* as a tag beside each pointer so a set can be searched without touching
+* any node. A tag match is only a candidate: the caller still checks the
+* node's key. The cache does not own the nodes; the tree must erase a node
+* before freeing it.
+*/
+template <typename NodeType>
+class FindCache
+{
+public:
+    static const unsigned WAYS = 4;
+
+    // Rounds entries up to a power of two number of sets
+    explicit FindCache(size_t entries)
+    {
+        size_t sets = 1;
+        while(sets * WAYS < entries) {
+            sets *= 2;
+        }
+        sets_.resize(sets);
+        setMask_ = sets - 1;
+        clear();
+    }
+
+    /**
+    * Returns the node cached under hash for which matches(node) is true,
+    * or NULL, and counts a hit or a miss. A hit moves to the front of its
+    * set.
+    */
+    template<typename Match>
+    NodeType* find(uint64_t hash, Match matches)
+    {
+        Set& set = sets_[hash & setMask_];
+        uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for(unsigned way = 0; way < WAYS; ++way) {
+            NodeType* node = set.nodes[way];
+            if(node != nullptr && set.tags[way] == tag && matches(node)) {
+                moveToFront(set, way, tag, node);
+                ++stats_.hits;
+                return node;
+            }
+        }
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    /**
+    * Caches node under hash in place of the least recently used entry of
+    * its set. It only moves up once it is found again, so a stream of keys
+    * looked up once each cannot push hot keys out.
+    */
+    void insert(uint64_t hash, NodeType* node)
+    {
+        Set& set = sets_[hash & setMask_];
+        set.tags[WAYS - 1] = static_cast<uint32_t>(hash >> 32);
+        set.nodes[WAYS - 1] = node;
+    }
+
+    // Drops node if it is cached under hash
+    void erase(uint64_t hash, const NodeType* node)
+    {
+        Set& set = sets_[hash & setMask_];
+        for(unsigned way = 0; way < WAYS; ++way) {
+            if(set.nodes[way] == node) {
+                //close the gap so the empty entry is the next to be filled
+                for(unsigned i = way; i + 1 < WAYS; ++i) {
+                    set.tags[i] = set.tags[i + 1];
+                    set.nodes[i] = set.nodes[i + 1];
+                }
+                set.nodes[WAYS - 1] = nullptr;
+                return;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for(size_t i = 0; i < sets_.size(); ++i) {
+            for(unsigned way = 0; way < WAYS; ++way) {
+                sets_[i].tags[way] = 0;
+                sets_[i].nodes[way] = nullptr;
+            }
+        }
+    }
+
+    size_t capacity() const { return sets_.size() * WAYS; }
+    const FindCacheStats& stats() const { return stats_; }
+    void resetStats() { stats_ = FindCacheStats(); }
+
+private:
+    struct Set
+    {
+        uint32_t tags[WAYS];
+        NodeType* nodes[WAYS];
+    };
+
+    // Shifts the entries before way back by one and puts node first
+    static void moveToFront(Set& set, unsigned way, uint32_t tag, NodeType* node)
+    {
+        for(unsigned i = way; i > 0; --i) {
+            set.tags[i] = set.tags[i - 1];
+            set.nodes[i] = set.nodes[i - 1];
+        }
+        set.tags[0] = tag;
+        set.nodes[0] = node;
+    }
+
+    std::vector<Set> sets_;
+    uint64_t setMask_;
+    FindCacheStats stats_;
+};
+
+#endif
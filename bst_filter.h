@@ -0,0 +1,121 @@
+#ifndef BST_FILTER_H
+#define BST_FILTER_H
+
+#include <cmath>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+* A Bloom filter over well-mixed key hashes, kept by
+* BinarySearchTree::enableFindFilter so lookups of absent keys can skip the
+* tree walk. It never reports a key it was given as absent; it reports an
+* absent key as present with about the configured false-positive rate
+* while it holds no more keys than it was sized for.
+*
+* The filter is blocked: all of a key's bits fall in one 64-byte block, so
+* a query costs one cache miss no matter how many bits it checks.
+*
+* A Bloom filter cannot forget a key, so removals are only counted. The
+* owner rebuilds the filter from its keys when needsRebuild says it holds
+* more keys than it was sized for, or too many removed ones.
+*/
+class KeyFilter
+{
+public:
+    KeyFilter(double falsePositiveRate, double rebuildFraction) :
+        rate_(falsePositiveRate), rebuildFraction_(rebuildFraction)
+    {
+        reset(0);
+    }
+
+    /**
+    * Empties the filter and sizes it for capacity keys.
+    */
+    void reset(size_t capacity)
+    {
+        const double ln2 = std::log(2.0);
+        double bitsPerKey = -std::log(rate_) / (ln2 * ln2);
+        capacity_ = capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity;
+        blocks_ = static_cast<uint64_t>(std::ceil(bitsPerKey * capacity_ / BLOCK_BITS));
+        probes_ = static_cast<unsigned>(std::lround(bitsPerKey * ln2));
+        probes_ = probes_ == 0 ? 1 : probes_;
+        words_.assign(blocks_ * BLOCK_WORDS, 0);
+        added_ = 0;
+        removed_ = 0;
+    }
+
+    void add(uint64_t h)
+    {
+        uint64_t* block = &words_[blockIndex(h) * BLOCK_WORDS];
+        uint64_t seed = h;
+        uint64_t bits = 0;
+        for(unsigned i = 0; i < probes_; ++i) {
+            unsigned bit = nextBit(seed, bits, i);
+            block[bit / 64] |= static_cast<uint64_t>(1) << (bit % 64);
+        }
+        ++added_;
+    }
+
+    bool mightContain(uint64_t h) const
+    {
+        const uint64_t* block = &words_[blockIndex(h) * BLOCK_WORDS];
+        uint64_t seed = h;
+        uint64_t bits = 0;
+        for(unsigned i = 0; i < probes_; ++i) {
+            unsigned bit = nextBit(seed, bits, i);
+            if((block[bit / 64] & (static_cast<uint64_t>(1) << (bit % 64))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void noteRemoved() { ++removed_; }
+
+    /**
+    * True once the filter holds more keys than it was sized for, or more
+    * than the rebuild fraction of the keys it holds have been removed.
+    */
+    bool needsRebuild() const
+    {
+        return added_ > capacity_ || removed_ > rebuildFraction_ * added_;
+    }
+
+    size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+
+private:
+    static const size_t MIN_CAPACITY = 1024;
+    static const unsigned BLOCK_BITS = 512;
+    static const unsigned BLOCK_WORDS = BLOCK_BITS / 64;
+
+    // Maps the low 32 bits onto [0, blocks_) with a multiply instead of a division
+    uint64_t blockIndex(uint64_t h) const { return ((h & 0xffffffffULL) * blocks_) >> 32; }
+
+    /**
+    * The bit inside the block for probe i. Every probe takes 9 fresh bits,
+    * so two keys in one block rarely share all their bits. A new word of
+    * bits is stepped out of seed every 7 probes.
+    */
+    static unsigned nextBit(uint64_t& seed, uint64_t& bits, unsigned i)
+    {
+        if(i % 7 == 0) {
+            seed = seed * 0x9e3779b97f4a7c15ULL + 0x632be59bd9b4e019ULL;
+            bits = seed;
+        }
+        unsigned bit = static_cast<unsigned>(bits >> 55);
+        bits <<= 9;
+        return bit;
+    }
+
+    std::vector<uint64_t> words_;
+    uint64_t blocks_;
+    unsigned probes_;
+    size_t capacity_;
+    double rate_;
+    double rebuildFraction_;
+    size_t added_;
+    size_t removed_;
+};
+
+#endif
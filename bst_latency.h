@@ -0,0 +1,318 @@
+#ifndef BST_LATENCY_H
+#define BST_LATENCY_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* Latency instrumentation for the trees. LatencyTrackedTree times insert,
+* remove, find and clear and records the results in log-linear histograms.
+*
+* Overhead budget: an unsampled operation pays one thread-local increment.
+* A sampled one adds two steady_clock reads (25-40 ns each) and two relaxed
+* atomic updates. The reads also keep neighbouring operations from
+* overlapping their cache misses. The default sample period of 16 is meant
+* to stay within a few percent of an untracked find, while timing every
+* operation can cost up to a third. Check with "bst-bench latency", which
+* runs both periods against the same tree. steady_clock is used rather than
+* the raw TSC because the TSC is not guaranteed to be synchronized across
+* cores.
+*/
+
+enum LatencyOp
+{
+    LATENCY_INSERT,
+    LATENCY_REMOVE,
+    LATENCY_FIND,
+    LATENCY_CLEAR,
+    LATENCY_OP_COUNT
+};
+
+/**
+* Quantiles of one operation's latency, in nanoseconds. Quantiles are the
+* upper bound of their histogram bucket, so they overstate by at most 1/16.
+*/
+struct LatencySummary
+{
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+};
+
+/**
+* A lock-free log-linear histogram. Values below 16 get a bucket each.
+* Each power of two above that is split into 16 linear buckets. Values of
+* 2^40 ns (about 18 minutes) or more go into the last bucket.
+*/
+class LatencyHistogram
+{
+public:
+    static const unsigned SUB_BITS = 4;
+    static const unsigned SUBS = 1u << SUB_BITS;
+    static const unsigned MAX_EXPONENT = 40;
+    static const unsigned BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) * SUBS;
+
+    LatencyHistogram() { reset(); }
+
+    void record(uint64_t nanos)
+    {
+        counts_[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while(nanos > max && !max_.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Adds this histogram's counts into counts (BUCKETS entries)
+    void mergeInto(std::vector<uint64_t>& counts, uint64_t& max) const
+    {
+        for(unsigned i = 0; i < BUCKETS; ++i) {
+            counts[i] += counts_[i].load(std::memory_order_relaxed);
+        }
+        uint64_t m = max_.load(std::memory_order_relaxed);
+        if(m > max) {
+            max = m;
+        }
+    }
+
+    void reset()
+    {
+        for(unsigned i = 0; i < BUCKETS; ++i) {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    static unsigned bucketOf(uint64_t value)
+    {
+        if(value < SUBS) {
+            return static_cast<unsigned>(value);
+        }
+        unsigned exponent = 63 - __builtin_clzll(value);
+        if(exponent > MAX_EXPONENT) {
+            return BUCKETS - 1;
+        }
+        unsigned sub = static_cast<unsigned>(value >> (exponent - SUB_BITS)) & (SUBS - 1);
+        return (exponent - SUB_BITS + 1) * SUBS + sub;
+    }
+
+    // Largest value that falls into bucket
+    static uint64_t bucketUpper(unsigned bucket)
+    {
+        if(bucket < SUBS) {
+            return bucket;
+        }
+        unsigned exponent = bucket / SUBS + SUB_BITS - 1;
+        uint64_t width = 1ULL << (exponent - SUB_BITS);
+        return (SUBS + bucket % SUBS) * width + width - 1;
+    }
+
+private:
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    std::atomic<uint64_t> counts_[BUCKETS];
+    std::atomic<uint64_t> max_;
+};
+
+/**
+* One histogram per operation per thread slot. Threads are assigned slots
+* round robin as they first record, so threads do not contend on the same
+* counters until there are more than LATENCY_SLOTS of them. Reads merge all
+* slots, and recording never blocks.
+*/
+class LatencyRecorder
+{
+public:
+    static const unsigned LATENCY_SLOTS = 16;
+
+    /**
+    * samplePeriod is rounded up to a power of two. Each thread times one
+    * operation in every samplePeriod.
+    */
+    explicit LatencyRecorder(unsigned samplePeriod = 16) :
+        slots_(new Slot[LATENCY_SLOTS]), sampleMask_(0)
+    {
+        while(sampleMask_ + 1 < samplePeriod) {
+            sampleMask_ = (sampleMask_ << 1) | 1;
+        }
+    }
+
+    ~LatencyRecorder() { delete [] slots_; }
+
+    bool sample() const
+    {
+        static thread_local uint32_t tick = 0;
+        return (++tick & sampleMask_) == 0;
+    }
+
+    void record(LatencyOp op, std::chrono::steady_clock::time_point start)
+    {
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        slots_[threadSlot()].histograms[op].record(nanos);
+    }
+
+    LatencySummary summary(LatencyOp op) const
+    {
+        std::vector<uint64_t> counts(LatencyHistogram::BUCKETS, 0);
+        LatencySummary result = LatencySummary();
+        for(unsigned s = 0; s < LATENCY_SLOTS; ++s) {
+            slots_[s].histograms[op].mergeInto(counts, result.max);
+        }
+        for(unsigned i = 0; i < counts.size(); ++i) {
+            result.count += counts[i];
+        }
+        result.p50 = quantile(counts, result.count, result.max, 0.50);
+        result.p99 = quantile(counts, result.count, result.max, 0.99);
+        result.p999 = quantile(counts, result.count, result.max, 0.999);
+        return result;
+    }
+
+    // Not synchronized with concurrent recording; counts in flight may survive
+    void reset()
+    {
+        for(unsigned s = 0; s < LATENCY_SLOTS; ++s) {
+            for(unsigned op = 0; op < LATENCY_OP_COUNT; ++op) {
+                slots_[s].histograms[op].reset();
+            }
+        }
+    }
+
+private:
+    LatencyRecorder(const LatencyRecorder&);
+    LatencyRecorder& operator=(const LatencyRecorder&);
+
+    struct Slot
+    {
+        LatencyHistogram histograms[LATENCY_OP_COUNT];
+        char padding[64];   // keeps neighbouring slots off each other's cache lines
+    };
+
+    static unsigned threadSlot()
+    {
+        static std::atomic<unsigned> nextSlot(0);
+        static thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % LATENCY_SLOTS;
+        return slot;
+    }
+
+    // Nearest-rank quantile, reported as the upper bound of its bucket
+    static uint64_t quantile(const std::vector<uint64_t>& counts, uint64_t total, uint64_t max, double q)
+    {
+        if(total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+        uint64_t seen = 0;
+        for(unsigned i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if(seen >= rank && counts[i] > 0) {
+                uint64_t upper = LatencyHistogram::bucketUpper(i);
+                return upper < max ? upper : max;
+            }
+        }
+        return max;
+    }
+
+    Slot* slots_;
+    uint32_t sampleMask_;
+};
+
+/**
+* A tree that records the latency of insert, remove, find and clear.
+* Tree is the tree type to instrument; all its other operations are
+* inherited unchanged. insert and remove are virtual and are timed through
+* a base class reference as well, but find and clear are only timed when
+* called through this type.
+*/
+template <typename Key, typename Value, typename Tree = AVLTree<Key, Value> >
+class LatencyTrackedTree : public Tree
+{
+public:
+    typedef typename Tree::iterator iterator;
+
+    explicit LatencyTrackedTree(unsigned samplePeriod = 16);
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    iterator find(const Key& key) const;
+    void clear();
+
+    LatencySummary latency(LatencyOp op) const;
+    void resetLatency();
+
+private:
+    mutable LatencyRecorder recorder_;
+};
+
+template<typename Key, typename Value, typename Tree>
+LatencyTrackedTree<Key, Value, Tree>::LatencyTrackedTree(unsigned samplePeriod) :
+    Tree(), recorder_(samplePeriod)
+{
+}
+
+template<typename Key, typename Value, typename Tree>
+void LatencyTrackedTree<Key, Value, Tree>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if(!recorder_.sample()) {
+        Tree::insert(keyValuePair);
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Tree::insert(keyValuePair);
+    recorder_.record(LATENCY_INSERT, start);
+}
+
+template<typename Key, typename Value, typename Tree>
+void LatencyTrackedTree<Key, Value, Tree>::remove(const Key& key)
+{
+    if(!recorder_.sample()) {
+        Tree::remove(key);
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Tree::remove(key);
+    recorder_.record(LATENCY_REMOVE, start);
+}
+
+template<typename Key, typename Value, typename Tree>
+typename LatencyTrackedTree<Key, Value, Tree>::iterator
+LatencyTrackedTree<Key, Value, Tree>::find(const Key& key) const
+{
+    if(!recorder_.sample()) {
+        return Tree::find(key);
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    iterator it = Tree::find(key);
+    recorder_.record(LATENCY_FIND, start);
+    return it;
+}
+
+/**
+* clear is always timed, since it is rare and usually the slowest operation.
+*/
+template<typename Key, typename Value, typename Tree>
+void LatencyTrackedTree<Key, Value, Tree>::clear()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Tree::clear();
+    recorder_.record(LATENCY_CLEAR, start);
+}
+
+template<typename Key, typename Value, typename Tree>
+LatencySummary LatencyTrackedTree<Key, Value, Tree>::latency(LatencyOp op) const
+{
+    return recorder_.summary(op);
+}
+
+template<typename Key, typename Value, typename Tree>
+void LatencyTrackedTree<Key, Value, Tree>::resetLatency()
+{
+    recorder_.reset();
+}
+
+#endif
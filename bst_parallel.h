@@ -0,0 +1,92 @@
+#ifndef BST_PARALLEL_H
+#define BST_PARALLEL_H
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+/**
+* Number of threads to use when the caller does not say: one per hardware
+* thread, or 1 if that is unknown.
+*/
+inline unsigned defaultThreadCount()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+/**
+* Calls f(i) for every i in [0, count) on up to threads threads, the calling
+* thread included, and returns when all calls have finished. Indices are
+* handed out one at a time, so uneven tasks (subtrees of different sizes)
+* still keep every thread busy.
+*/
+template<typename F>
+void parallelFor(size_t count, unsigned threads, F f)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for(size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            f(i);
+        }
+    };
+    if(threads > count) {
+        threads = static_cast<unsigned>(count);
+    }
+    std::vector<std::thread> helpers;
+    for(unsigned t = 1; t < threads; ++t) {
+        helpers.push_back(std::thread(worker));
+    }
+    worker();
+    for(size_t t = 0; t < helpers.size(); ++t) {
+        helpers[t].join();
+    }
+}
+
+/**
+* A small id for the calling thread, unique among live threads. Ids are
+* handed back when their thread exits, so they stay dense and can index a
+* fixed table of per-thread slots, as FlatCombiningTree and
+* ConcurrentAVLTree do.
+*/
+class ThreadIndex
+{
+public:
+    static unsigned current()
+    {
+        static thread_local ThreadIndex id;
+        return id.id_;
+    }
+
+private:
+    ThreadIndex()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if(freeIds().empty()) {
+            id_ = nextId()++;
+        }
+        else {
+            id_ = freeIds().back();
+            freeIds().pop_back();
+        }
+    }
+
+    ~ThreadIndex()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        freeIds().push_back(id_);
+    }
+
+    ThreadIndex(const ThreadIndex&);
+    ThreadIndex& operator=(const ThreadIndex&);
+
+    static std::mutex& mutex() { static std::mutex m; return m; }
+    static std::vector<unsigned>& freeIds() { static std::vector<unsigned> ids; return ids; }
+    static unsigned& nextId() { static unsigned next = 0; return next; }
+
+    unsigned id_;
+};
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef BST_PROFILE_H
+#define BST_PROFILE_H
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* A run of keys that are adjacent in key order and all lie near the bottom
+* of the tree. Lookups for these keys take the longest paths.
+*/
+template <typename Key>
+struct DeepKeyRange
+{
+    Key first;
+    Key last;
+    size_t nodes;
+    int maxDepth;
+};
+
+/**
+* The shape of a tree as measured by profileShape. Depths count edges from
+* the root (the root is at depth 0), so a successful find of a node at depth
+* d makes d + 1 comparisons.
+*/
+template <typename Key>
+struct ShapeProfile
+{
+    size_t nodes;
+    size_t leaves;
+    int height;                             // number of levels, 0 when empty
+    std::vector<size_t> depthCounts;        // nodes at each depth
+    std::vector<size_t> leafDepthCounts;    // leaves at each depth
+    int minLeafDepth;
+    int maxLeafDepth;
+    double averagePath;                     // mean comparisons over successful finds
+    int maxPath;
+    bool hasBalances;                       // balanceCounts is filled for AVL trees
+    size_t balanceCounts[5];                // nodes with balance -2..+2, clamped at the ends
+    std::vector<DeepKeyRange<Key> > deepRanges;     // largest first
+
+    ShapeProfile() :
+        nodes(0), leaves(0), height(0), minLeafDepth(0), maxLeafDepth(0),
+        averagePath(0), maxPath(0), hasBalances(false), balanceCounts()
+    {
+    }
+};
+
+/**
+* Collects a ShapeProfile in a single in-order pass. The walk follows parent
+* pointers instead of using a stack, so besides the profile itself (whose
+* histograms have one entry per level) it needs O(1) memory, and it is safe
+* on degenerate trees of any depth.
+*/
+template <typename Key, typename Value>
+class ShapeProfiler
+{
+public:
+    static ShapeProfile<Key> run(const BinarySearchTree<Key, Value>& tree, bool avl, int slack, size_t maxRanges);
+
+private:
+    static void addRange(std::vector<DeepKeyRange<Key> >& ranges, const DeepKeyRange<Key>& range, size_t maxRanges);
+    static bool largerRange(const DeepKeyRange<Key>& a, const DeepKeyRange<Key>& b) { return a.nodes > b.nodes; }
+};
+
+/**
+* Keeps the maxRanges largest runs seen so far.
+*/
+template<typename Key, typename Value>
+void ShapeProfiler<Key, Value>::addRange(std::vector<DeepKeyRange<Key> >& ranges, const DeepKeyRange<Key>& range,
+                                         size_t maxRanges)
+{
+    if(ranges.size() < maxRanges) {
+        ranges.push_back(range);
+        return;
+    }
+    typename std::vector<DeepKeyRange<Key> >::iterator smallest =
+        std::min_element(ranges.begin(), ranges.end(), [](const DeepKeyRange<Key>& a, const DeepKeyRange<Key>& b) {
+            return a.nodes < b.nodes;
+        });
+    if(smallest != ranges.end() && smallest->nodes < range.nodes) {
+        *smallest = range;
+    }
+}
+
+template<typename Key, typename Value>
+ShapeProfile<Key> ShapeProfiler<Key, Value>::run(const BinarySearchTree<Key, Value>& tree, bool avl, int slack,
+                                                 size_t maxRanges)
+{
+    ShapeProfile<Key> profile;
+    profile.hasBalances = avl;
+    const Node<Key, Value>* node = tree.root_;
+    if(node == nullptr) {
+        return profile;
+    }
+    // the stored height tells up front which depths count as deep
+    profile.height = tree.height();
+    int deepDepth = std::max(0, profile.height - 1 - slack);
+    profile.depthCounts.assign(profile.height, 0);
+    profile.leafDepthCounts.assign(profile.height, 0);
+    profile.minLeafDepth = profile.height;
+
+    double pathTotal = 0;
+    bool inRun = false;
+    DeepKeyRange<Key> run = DeepKeyRange<Key>();
+    int depth = 0;
+    while(node->getLeft() != nullptr) {
+        node = node->getLeft();
+        ++depth;
+    }
+    while(node != nullptr) {
+        // visit node
+        ++profile.nodes;
+        ++profile.depthCounts[depth];
+        pathTotal += depth + 1;
+        if(node->getLeft() == nullptr && node->getRight() == nullptr) {
+            ++profile.leaves;
+            ++profile.leafDepthCounts[depth];
+            profile.minLeafDepth = std::min(profile.minLeafDepth, depth);
+            profile.maxLeafDepth = std::max(profile.maxLeafDepth, depth);
+        }
+        if(avl) {
+            int balance = static_cast<const AVLNode<Key, Value>*>(node)->getBalance();
+            ++profile.balanceCounts[std::min(4, std::max(0, balance + 2))];
+        }
+        if(depth >= deepDepth) {
+            if(!inRun) {
+                run.first = node->getKey();
+                run.nodes = 0;
+                run.maxDepth = 0;
+                inRun = true;
+            }
+            run.last = node->getKey();
+            ++run.nodes;
+            run.maxDepth = std::max(run.maxDepth, depth);
+        }
+        else if(inRun) {
+            addRange(profile.deepRanges, run, maxRanges);
+            inRun = false;
+        }
+
+        // move to the in-order successor, keeping track of the depth
+        if(node->getRight() != nullptr) {
+            node = node->getRight();
+            ++depth;
+            while(node->getLeft() != nullptr) {
+                node = node->getLeft();
+                ++depth;
+            }
+        }
+        else {
+            const Node<Key, Value>* child = node;
+            node = node->getParent();
+            --depth;
+            while(node != nullptr && node->getRight() == child) {
+                child = node;
+                node = node->getParent();
+                --depth;
+            }
+        }
+    }
+    if(inRun) {
+        addRange(profile.deepRanges, run, maxRanges);
+    }
+    std::sort(profile.deepRanges.begin(), profile.deepRanges.end(), largerRange);
+    profile.averagePath = pathTotal / profile.nodes;
+    profile.maxPath = profile.height;
+    return profile;
+}
+
+/**
+* Profiles the shape of a BinarySearchTree. Nodes within slack levels of
+* the deepest level count as deep, and up to maxRanges of the largest runs of
+* deep keys are kept.
+*/
+template<typename Key, typename Value>
+ShapeProfile<Key> profileShape(const BinarySearchTree<Key, Value>& tree, int slack = 2, size_t maxRanges = 10)
+{
+    return ShapeProfiler<Key, Value>::run(tree, false, slack, maxRanges);
+}
+
+/**
+* Profiles the shape of an AVLTree, including the distribution of balances.
+*/
+template<typename Key, typename Value>
+ShapeProfile<Key> profileShape(const AVLTree<Key, Value>& tree, int slack = 2, size_t maxRanges = 10)
+{
+    return ShapeProfiler<Key, Value>::run(tree, true, slack, maxRanges);
+}
+
+/**
+* Prints a profile in a readable form. Key must support operator<<.
+*/
+template<typename Key>
+void printShapeProfile(std::ostream& out, const ShapeProfile<Key>& profile)
+{
+    out << "nodes " << profile.nodes << ", leaves " << profile.leaves << ", height " << profile.height << "\n";
+    if(profile.nodes == 0) {
+        return;
+    }
+    out << "search path: average " << profile.averagePath << ", max " << profile.maxPath << "\n";
+    out << "leaf depths: " << profile.minLeafDepth << " to " << profile.maxLeafDepth
+        << " (spread " << profile.maxLeafDepth - profile.minLeafDepth << ")\n";
+    out << "depth   nodes   leaves\n";
+    for(size_t d = 0; d < profile.depthCounts.size(); ++d) {
+        out << d << "\t" << profile.depthCounts[d] << "\t" << profile.leafDepthCounts[d] << "\n";
+    }
+    if(profile.hasBalances) {
+        out << "balance:";
+        for(int b = 0; b < 5; ++b) {
+            out << " " << (b - 2 > 0 ? "+" : "") << b - 2 << ":" << profile.balanceCounts[b];
+        }
+        out << "\n";
+    }
+    out << "deepest key ranges:\n";
+    for(size_t i = 0; i < profile.deepRanges.size(); ++i) {
+        const DeepKeyRange<Key>& range = profile.deepRanges[i];
+        out << "  [" << range.first << ", " << range.last << "] " << range.nodes
+            << " nodes, max depth " << range.maxDepth << "\n";
+    }
+}
+
+#endif
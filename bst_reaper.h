@@ -0,0 +1,92 @@
+#ifndef BST_REAPER_H
+#define BST_REAPER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+* A single background thread that frees detached trees for
+* BinarySearchTree::clearAsync. Jobs run in submission order. At exit the
+* thread finishes every queued job before it is joined, so no memory is
+* leaked.
+*/
+class TreeReaper
+{
+public:
+    static TreeReaper& instance()
+    {
+        static TreeReaper reaper;
+        return reaper;
+    }
+
+    void submit(const std::function<void()>& job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+        wake_.notify_one();
+    }
+
+    /**
+    * Blocks until every job submitted so far has run.
+    */
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!jobs_.empty() || busy_) {
+            idle_.wait(lock);
+        }
+    }
+
+    ~TreeReaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            wake_.notify_one();
+        }
+        thread_.join();
+    }
+
+private:
+    TreeReaper() : busy_(false), stopping_(false)
+    {
+        thread_ = std::thread(&TreeReaper::run, this);
+    }
+    TreeReaper(const TreeReaper&);
+    TreeReaper& operator=(const TreeReaper&);
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(true) {
+            if(jobs_.empty()) {
+                busy_ = false;
+                idle_.notify_all();
+                if(stopping_) {
+                    return;
+                }
+                wake_.wait(lock);
+                continue;
+            }
+            std::function<void()> job = jobs_.front();
+            jobs_.pop_front();
+            busy_ = true;
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::function<void()> > jobs_;
+    bool busy_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+#endif
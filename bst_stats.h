@@ -0,0 +1,39 @@
+#ifndef BST_STATS_H
+#define BST_STATS_H
+
+#include <stdint.h>
+
+/**
+* A snapshot of the operation counters of a tree. The counters are only
+* kept when compiled with -DBST_STATS (see DEFS in the Makefile); otherwise
+* the hooks compile to nothing and stats() always returns zeros.
+*
+* Counters are plain integers: a tree shared between threads needs the same
+* external locking for stats() as for its other operations.
+*/
+struct TreeStats
+{
+    uint64_t comparisons;       // key comparisons made while searching and inserting
+    uint64_t rotateLefts;       // AVLTree::rotateLeft calls
+    uint64_t rotateRights;      // AVLTree::rotateRight calls
+    uint64_t insertFixSteps;    // levels AVLTree::insertFix propagated up
+    uint64_t removeFixSteps;    // levels AVLTree::removeFix propagated up
+    uint64_t nodeSwaps;         // nodeSwap calls
+    uint64_t allocations;       // nodes allocated
+    uint64_t frees;             // nodes freed
+    uint64_t filterRejects;     // lookups the find filter answered without walking the tree
+
+    TreeStats() :
+        comparisons(0), rotateLefts(0), rotateRights(0), insertFixSteps(0),
+        removeFixSteps(0), nodeSwaps(0), allocations(0), frees(0), filterRejects(0)
+    {
+    }
+};
+
+#ifdef BST_STATS
+#define BST_STAT_ADD(counter, n) (this->stats_.counter += (n))
+#else
+#define BST_STAT_ADD(counter, n) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef BST_VALIDATE_H
+#define BST_VALIDATE_H
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "avlbst.h"
+#include "bst_parallel.h"
+
+/**
+* Result of validateTree. If the tree is invalid, problem describes the
+* first violation found and key and depth locate the node. nodes and height
+* describe the whole tree only when it is valid.
+*/
+template <typename Key>
+struct ValidationReport
+{
+    bool valid;
+    std::string problem;
+    Key key;
+    size_t depth;       // depth of the offending node, the root is at 0
+    size_t nodes;
+    int height;         // 0 for an empty tree
+
+    ValidationReport() : valid(true), key(), depth(0), nodes(0), height(0) {}
+};
+
+/**
+* Checks a tree's structure: every key lies between its subtrees' keys,
+* every child's parent pointer points back, and the root has no parent. For
+* an AVLTree it also checks that each stored balance equals the real height
+* difference and that no difference exceeds 1.
+*
+* The tree is cut at a shallow depth into subtrees that are checked in
+* parallel. Each subtree check is iterative, so degenerate trees cannot
+* overflow the stack. The per-subtree summaries (size, height, min and max
+* key) are then combined over the top levels. Once a violation is found the
+* other workers stop early. If several nodes are bad, scheduling decides
+* which one is reported.
+*/
+template <typename Key, typename Value>
+class TreeValidator
+{
+public:
+    static ValidationReport<Key> validate(const BinarySearchTree<Key, Value>& tree, bool avl, unsigned threads);
+
+private:
+    typedef Node<Key, Value> TreeNode;
+
+    // What a parent needs to know about a checked subtree
+    struct Summary
+    {
+        size_t count;
+        int height;
+        const TreeNode* min;
+        const TreeNode* max;
+    };
+
+    struct Task
+    {
+        const TreeNode* root;
+        size_t depth;
+        Summary result;
+        bool failed;
+        std::string problem;
+        const TreeNode* node;
+        size_t nodeDepth;
+    };
+
+    struct Frame
+    {
+        const TreeNode* node;
+        int stage;          // 0: descend left, 1: visit and descend right, 2: check balance
+        int leftHeight;
+    };
+
+    static Summary empty();
+    static bool checkNode(const TreeNode* node, const Summary& left, const Summary& right, bool avl,
+                          std::string& problem, Summary& result);
+    static bool checkBalance(const TreeNode* node, int leftHeight, int rightHeight, std::string& problem);
+    static bool checkLink(const TreeNode* child, const TreeNode* node, std::string& problem);
+    static void collect(const TreeNode* node, size_t depth, size_t splitDepth, std::vector<Task>& tasks);
+    static void walk(Task& task, bool avl, std::atomic<bool>& stop);
+    static bool combine(const TreeNode* node, size_t depth, size_t splitDepth, bool avl,
+                        std::vector<Task>& tasks, size_t& next, Summary& result, ValidationReport<Key>& report);
+};
+
+template<typename Key, typename Value>
+typename TreeValidator<Key, Value>::Summary TreeValidator<Key, Value>::empty()
+{
+    Summary summary = { 0, 0, NULL, NULL };
+    return summary;
+}
+
+/**
+* Checks node against the summaries of its subtrees and fills in its own
+* summary. Returns false and sets problem on a violation.
+*/
+template<typename Key, typename Value>
+bool TreeValidator<Key, Value>::checkNode(const TreeNode* node, const Summary& left, const Summary& right,
+                                          bool avl, std::string& problem, Summary& result)
+{
+    if(left.count != 0 && !(left.max->getKey() < node->getKey())) {
+        problem = "key is not greater than every key in its left subtree";
+        return false;
+    }
+    if(right.count != 0 && !(node->getKey() < right.min->getKey())) {
+        problem = "key is not less than every key in its right subtree";
+        return false;
+    }
+    if(avl && !checkBalance(node, left.height, right.height, problem)) {
+        return false;
+    }
+    result.count = left.count + right.count + 1;
+    result.height = 1 + (left.height > right.height ? left.height : right.height);
+    result.min = left.count != 0 ? left.min : node;
+    result.max = right.count != 0 ? right.max : node;
+    return true;
+}
+
+template<typename Key, typename Value>
+bool TreeValidator<Key, Value>::checkBalance(const TreeNode* node, int leftHeight, int rightHeight, std::string& problem)
+{
+    int difference = rightHeight - leftHeight;
+    int stored = static_cast<const AVLNode<Key, Value>*>(node)->getBalance();
+    if(stored != difference) {
+        problem = "stored balance " + std::to_string(stored) +
+                  " does not match subtree heights (" + std::to_string(difference) + ")";
+        return false;
+    }
+    if(std::abs(difference) > 1) {
+        problem = "subtree heights differ by " + std::to_string(difference);
+        return false;
+    }
+    return true;
+}
+
+/**
+* Checked before descending into a child. Together with the root having no
+* parent this also rules out cycles, since a cycle could only be entered
+* through a node whose parent pointer is wrong.
+*/
+template<typename Key, typename Value>
+bool TreeValidator<Key, Value>::checkLink(const TreeNode* child, const TreeNode* node, std::string& problem)
+{
+    if(child != NULL && child->getParent() != node) {
+        problem = child == node->getLeft() ? "left child's parent pointer does not point back"
+                                           : "right child's parent pointer does not point back";
+        return false;
+    }
+    return true;
+}
+
+// Gathers the subtrees at splitDepth, left to right
+template<typename Key, typename Value>
+void TreeValidator<Key, Value>::collect(const TreeNode* node, size_t depth, size_t splitDepth, std::vector<Task>& tasks)
+{
+    if(node == NULL) {
+        return;
+    }
+    if(depth == splitDepth) {
+        Task task = Task();
+        task.root = node;
+        task.depth = depth;
+        tasks.push_back(task);
+        return;
+    }
+    collect(node->getLeft(), depth + 1, splitDepth, tasks);
+    collect(node->getRight(), depth + 1, splitDepth, tasks);
+}
+
+/**
+* Checks one subtree with an explicit stack. Ordering is checked by
+* comparing each node with its in-order predecessor, which was visited
+* recently and is usually still in cache. Heights are computed post-order.
+*/
+template<typename Key, typename Value>
+void TreeValidator<Key, Value>::walk(Task& task, bool avl, std::atomic<bool>& stop)
+{
+    std::vector<Frame> stack;
+    Frame first = { task.root, 0, 0 };
+    stack.push_back(first);
+    const TreeNode* min = NULL;
+    const TreeNode* prev = NULL;
+    size_t count = 0;
+    int returnedHeight = 0;
+    while(!stack.empty()) {
+        if((count & 4095) == 0 && stop.load(std::memory_order_relaxed)) {
+            return;
+        }
+        Frame& frame = stack.back();
+        const TreeNode* node = frame.node;
+        const TreeNode* child = NULL;
+        if(frame.stage == 0) {
+            child = node->getLeft();
+        }
+        else if(frame.stage == 1) {
+            frame.leftHeight = returnedHeight;
+            if(prev != NULL && !(prev->getKey() < node->getKey())) {
+                task.problem = "key is not greater than the key before it in order";
+                break;
+            }
+            if(min == NULL) {
+                min = node;
+            }
+            prev = node;
+            ++count;
+            child = node->getRight();
+        }
+        else {
+            if(avl && !checkBalance(node, frame.leftHeight, returnedHeight, task.problem)) {
+                break;
+            }
+            returnedHeight = 1 + (frame.leftHeight > returnedHeight ? frame.leftHeight : returnedHeight);
+            stack.pop_back();
+            continue;
+        }
+        ++frame.stage;
+        if(child == NULL) {
+            returnedHeight = 0;
+            continue;
+        }
+        if(!checkLink(child, node, task.problem)) {
+            break;
+        }
+        Frame next = { child, 0, 0 };
+        stack.push_back(next);
+    }
+    if(!stack.empty()) {
+        task.failed = true;
+        task.node = stack.back().node;
+        task.nodeDepth = task.depth + stack.size() - 1;
+        stop.store(true, std::memory_order_relaxed);
+        return;
+    }
+    Summary summary = { count, returnedHeight, min, prev };
+    task.result = summary;
+}
+
+// Checks the nodes above splitDepth from the subtree results, in the same order as collect
+template<typename Key, typename Value>
+bool TreeValidator<Key, Value>::combine(const TreeNode* node, size_t depth, size_t splitDepth, bool avl,
+                                        std::vector<Task>& tasks, size_t& next, Summary& result,
+                                        ValidationReport<Key>& report)
+{
+    if(node == NULL) {
+        result = empty();
+        return true;
+    }
+    if(depth == splitDepth) {
+        result = tasks[next++].result;
+        return true;
+    }
+    Summary left, right;
+    if(!checkLink(node->getLeft(), node, report.problem) || !checkLink(node->getRight(), node, report.problem) ||
+       !combine(node->getLeft(), depth + 1, splitDepth, avl, tasks, next, left, report) ||
+       !combine(node->getRight(), depth + 1, splitDepth, avl, tasks, next, right, report)) {
+        if(report.valid) {
+            report.valid = false;
+            report.key = node->getKey();
+            report.depth = depth;
+        }
+        return false;
+    }
+    if(!checkNode(node, left, right, avl, report.problem, result)) {
+        report.valid = false;
+        report.key = node->getKey();
+        report.depth = depth;
+        return false;
+    }
+    return true;
+}
+
+template<typename Key, typename Value>
+ValidationReport<Key> TreeValidator<Key, Value>::validate(const BinarySearchTree<Key, Value>& tree, bool avl,
+                                                          unsigned threads)
+{
+    ValidationReport<Key> report;
+    const TreeNode* root = tree.root_;
+    if(root == NULL) {
+        return report;
+    }
+    if(root->getParent() != NULL) {
+        report.valid = false;
+        report.problem = "root has a parent";
+        report.key = root->getKey();
+        return report;
+    }
+
+    // about four subtrees per thread, so uneven subtrees still balance out
+    size_t splitDepth = 0;
+    while(threads > 1 && (size_t(1) << splitDepth) < 4 * size_t(threads)) {
+        ++splitDepth;
+    }
+    std::vector<Task> tasks;
+    collect(root, 0, splitDepth, tasks);
+    std::atomic<bool> stop(false);
+    parallelFor(tasks.size(), threads, [&](size_t i) {
+        walk(tasks[i], avl, stop);
+    });
+    for(size_t i = 0; i < tasks.size(); ++i) {
+        if(tasks[i].failed) {
+            report.valid = false;
+            report.problem = tasks[i].problem;
+            report.key = tasks[i].node->getKey();
+            report.depth = tasks[i].nodeDepth;
+            return report;
+        }
+    }
+
+    Summary summary;
+    size_t next = 0;
+    if(combine(root, 0, splitDepth, avl, tasks, next, summary, report)) {
+        report.nodes = summary.count;
+        report.height = summary.height;
+    }
+    return report;
+}
+
+/**
+* Validates a BinarySearchTree's ordering and parent pointers on threads threads.
+*/
+template<typename Key, typename Value>
+ValidationReport<Key> validateTree(const BinarySearchTree<Key, Value>& tree, unsigned threads = defaultThreadCount())
+{
+    return TreeValidator<Key, Value>::validate(tree, false, threads);
+}
+
+/**
+* Validates an AVLTree: ordering, parent pointers, stored balances and the AVL property.
+*/
+template<typename Key, typename Value>
+ValidationReport<Key> validateTree(const AVLTree<Key, Value>& tree, unsigned threads = defaultThreadCount())
+{
+    return TreeValidator<Key, Value>::validate(tree, true, threads);
+}
+
+#endif
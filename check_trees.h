@@ -0,0 +1,91 @@
+// check_trees.h - helpers shared by the tree-tests suite
+
+#ifndef CHECK_TREES_H
+#define CHECK_TREES_H
+
+#include <cstdlib>
+#include <map>
+#include <ostream>
+#include "avlbst.h"
+
+/**
+* An int that counts how many instances are alive, so tests can tell when
+* a tree has freed its nodes.
+*/
+struct LiveValue
+{
+    static int live;
+    int value;
+
+    LiveValue(int v = 0) : value(v) { ++live; }
+    LiveValue(const LiveValue& other) : value(other.value) { ++live; }
+    LiveValue& operator=(const LiveValue& other) { value = other.value; return *this; }
+    ~LiveValue() { --live; }
+};
+
+inline bool operator==(const LiveValue& a, const LiveValue& b) { return a.value == b.value; }
+
+// Lets the trees print LiveValue values
+inline std::ostream& operator<<(std::ostream& out, const LiveValue& v)
+{
+    return out << v.value;
+}
+
+/**
+* The tree's entries in iteration order, for comparing against a std::map.
+*/
+template<typename Tree, typename Key, typename Value>
+std::map<Key, Value> contents(const Tree& tree)
+{
+    std::map<Key, Value> result;
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        result.insert(std::make_pair(it->first, it->second));
+    }
+    return result;
+}
+
+/**
+* The root of any tree, read through the protected member without a cast.
+*/
+template<typename Key, typename Value>
+struct RootAccess : public BinarySearchTree<Key, Value>
+{
+    static Node<Key, Value>* of(const BinarySearchTree<Key, Value>& tree)
+    {
+        Node<Key, Value>* BinarySearchTree<Key, Value>::* root = &RootAccess::root_;
+        return tree.*root;
+    }
+};
+
+/**
+* Height of the AVL subtree at node, or -1 if any node in it has a stored
+* balance other than its right height minus its left height, or one
+* outside [-1, 1]. Also checks the parent links.
+*/
+template<typename Key, typename Value>
+int checkedAVLHeight(const AVLNode<Key, Value>* node)
+{
+    if(node == nullptr) {
+        return 0;
+    }
+    if((node->getLeft() != nullptr && node->getLeft()->getParent() != node) ||
+       (node->getRight() != nullptr && node->getRight()->getParent() != node)) {
+        return -1;
+    }
+    int left = checkedAVLHeight(node->getLeft());
+    int right = checkedAVLHeight(node->getRight());
+    if(left == -1 || right == -1 || right - left != node->getBalance() || std::abs(right - left) > 1) {
+        return -1;
+    }
+    return 1 + (left > right ? left : right);
+}
+
+// True if every stored balance in tree matches its actual subtree heights
+template<typename Key, typename Value>
+bool balancesMatchHeights(const AVLTree<Key, Value>& tree)
+{
+    const AVLNode<Key, Value>* root = static_cast<const AVLNode<Key, Value>*>(RootAccess<Key, Value>::of(tree));
+    return checkedAVLHeight(root) != -1;
+}
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef CONCURRENT_AVLBST_H
+#define CONCURRENT_AVLBST_H
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "bst_parallel.h"
+
+/**
+* An AVL tree for one writer at a time and any number of readers, where
+* find takes no lock at all.
+*
+* Child pointers are atomics, and every change a reader could observe is
+* made by building the new nodes off to the side and publishing them with
+* a single release store into a child pointer (or the root). A node a
+* reader can reach is never changed in place, except for the writer-only
+* height, so a reader always follows a consistent search path:
+*   - a new leaf is linked into an empty child pointer;
+*   - overwriting a value replaces the node with a copy;
+*   - a rotation builds copies of the two nodes it moves and publishes
+*     the new top, leaving the old pair intact for readers inside them;
+*   - removing a node with two children copies the path from it down to
+*     its successor and publishes the copy in its place, so readers see
+*     either the old subtree or the new one, never a mix.
+*
+* Replaced and unlinked nodes are retired with the current epoch. Each
+* reader announces the epoch it started in, and the writer frees a
+* retired node once every active reader started in a later epoch.
+*
+* Readers beyond the slot count (maxReaders, 256 by default) take the
+* writer lock instead. Writers are serialized by that lock.
+*/
+template <typename Key, typename Value>
+class ConcurrentAVLTree
+{
+public:
+    explicit ConcurrentAVLTree(unsigned maxReaders = 256);
+    ~ConcurrentAVLTree();
+
+    void insert(const std::pair<const Key, Value>& item);
+    void remove(const Key& key);
+    bool find(const Key& key, Value& value) const;
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool verify() const;
+    void reclaim();
+
+private:
+    struct CNode
+    {
+        CNode(const Key& k, const Value& v, CNode* l, CNode* r) :
+            key(k), value(v), left(l), right(r), height(1)
+        {
+        }
+
+        const Key key;
+        const Value value;
+        std::atomic<CNode*> left;
+        std::atomic<CNode*> right;
+        int height;         // only read and written by the writer
+    };
+
+    /**
+    * The epoch a reader started in, or READER_IDLE. Padded so readers do
+    * not share cache lines.
+    */
+    struct ReaderSlot
+    {
+        std::atomic<uint64_t> epoch;
+        char padding[64];
+
+        ReaderSlot() : epoch(READER_IDLE) {}
+    };
+
+    struct Retired
+    {
+        CNode* node;
+        uint64_t epoch;
+    };
+
+    static const uint64_t READER_IDLE = ~static_cast<uint64_t>(0);
+    // Retired nodes the writer lets pile up before trying to free some
+    static const size_t RECLAIM_BATCH = 256;
+
+    ConcurrentAVLTree(const ConcurrentAVLTree&);
+    ConcurrentAVLTree& operator=(const ConcurrentAVLTree&);
+
+    bool search(const Key& key, Value& value) const;
+    bool insert(std::atomic<CNode*>& slot, const Key& key, const Value& value);
+    bool remove(std::atomic<CNode*>& slot, const Key& key);
+    void removeMin(std::atomic<CNode*>& slot, CNode*& min);
+    void rebalance(std::atomic<CNode*>& slot);
+    void rotateLeft(std::atomic<CNode*>& slot);
+    void rotateRight(std::atomic<CNode*>& slot);
+    void retire(CNode* node);
+    void finishWrite();
+    void collect();
+    static CNode* child(const std::atomic<CNode*>& link) { return link.load(std::memory_order_relaxed); }
+    static int height(const CNode* node) { return node == nullptr ? 0 : node->height; }
+    static void fixHeight(CNode* node);
+    static int verify(const CNode* node, const Key* lo, const Key* hi);
+    static void destroy(CNode* node);
+
+    std::atomic<CNode*> root_;
+    std::atomic<size_t> size_;
+    std::atomic<uint64_t> epoch_;
+    mutable std::vector<ReaderSlot> readers_;
+    mutable std::mutex writer_;
+    // Nodes unlinked by the current write, retired once it has published everything
+    std::vector<CNode*> unlinked_;
+    // Retired nodes in epoch order, waiting for readers to move on
+    std::vector<Retired> retired_;
+};
+
+template<typename Key, typename Value>
+ConcurrentAVLTree<Key, Value>::ConcurrentAVLTree(unsigned maxReaders) :
+    root_(nullptr), size_(0), epoch_(0), readers_(maxReaders)
+{
+}
+
+/**
+* No reader or writer may still be using the tree.
+*/
+template<typename Key, typename Value>
+ConcurrentAVLTree<Key, Value>::~ConcurrentAVLTree()
+{
+    destroy(root_.load(std::memory_order_relaxed));
+    for(size_t i = 0; i < unlinked_.size(); ++i) {
+        delete unlinked_[i];
+    }
+    for(size_t i = 0; i < retired_.size(); ++i) {
+        delete retired_[i].node;
+    }
+}
+
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::destroy(CNode* node)
+{
+    //recurses on the shorter side only, so the stack stays O(log n) deep
+    while(node != nullptr) {
+        CNode* left = child(node->left);
+        CNode* right = child(node->right);
+        if(height(left) < height(right)) {
+            destroy(left);
+            delete node;
+            node = right;
+        }
+        else {
+            destroy(right);
+            delete node;
+            node = left;
+        }
+    }
+}
+
+/**
+* Copies the value for key into value and returns true, or returns false
+* if key is not present. Takes no lock and never waits for the writer.
+*/
+template<typename Key, typename Value>
+bool ConcurrentAVLTree<Key, Value>::find(const Key& key, Value& value) const
+{
+    unsigned id = ThreadIndex::current();
+    if(id >= readers_.size()) {
+        std::lock_guard<std::mutex> lock(writer_);
+        return search(key, value);
+    }
+    ReaderSlot& slot = readers_[id];
+    slot.epoch.store(epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+    //the announcement must be visible before the root is read, or the writer could free what we are about to see
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool found = search(key, value);
+    slot.epoch.store(READER_IDLE, std::memory_order_release);
+    return found;
+}
+
+template<typename Key, typename Value>
+bool ConcurrentAVLTree<Key, Value>::search(const Key& key, Value& value) const
+{
+    const CNode* node = root_.load(std::memory_order_acquire);
+    while(node != nullptr) {
+        if(key < node->key) {
+            node = node->left.load(std::memory_order_acquire);
+        }
+        else if(node->key < key) {
+            node = node->right.load(std::memory_order_acquire);
+        }
+        else {
+            value = node->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+* Inserts item, or replaces the value if the key is already present.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& item)
+{
+    std::lock_guard<std::mutex> lock(writer_);
+    if(insert(root_, item.first, item.second)) {
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    finishWrite();
+}
+
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::remove(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(writer_);
+    if(remove(root_, key)) {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    finishWrite();
+}
+
+/**
+* Inserts below slot and rebalances on the way back up. Returns true if a
+* node was added, false if an existing value was replaced.
+*/
+template<typename Key, typename Value>
+bool ConcurrentAVLTree<Key, Value>::insert(std::atomic<CNode*>& slot, const Key& key, const Value& value)
+{
+    CNode* node = child(slot);
+    if(node == nullptr) {
+        slot.store(new CNode(key, value, nullptr, nullptr), std::memory_order_release);
+        return true;
+    }
+    bool added;
+    if(key < node->key) {
+        added = insert(node->left, key, value);
+    }
+    else if(node->key < key) {
+        added = insert(node->right, key, value);
+    }
+    else {
+        //readers may be reading the old value, so it is replaced along with its node
+        CNode* copy = new CNode(key, value, child(node->left), child(node->right));
+        copy->height = node->height;
+        slot.store(copy, std::memory_order_release);
+        unlinked_.push_back(node);
+        return false;
+    }
+    if(added) {
+        rebalance(slot);
+    }
+    return added;
+}
+
+/**
+* Removes key from below slot and rebalances on the way back up. Returns
+* true if it was present.
+*/
+template<typename Key, typename Value>
+bool ConcurrentAVLTree<Key, Value>::remove(std::atomic<CNode*>& slot, const Key& key)
+{
+    CNode* node = child(slot);
+    if(node == nullptr) {
+        return false;
+    }
+    bool removed;
+    if(key < node->key) {
+        removed = remove(node->left, key);
+    }
+    else if(node->key < key) {
+        removed = remove(node->right, key);
+    }
+    else {
+        CNode* left = child(node->left);
+        CNode* right = child(node->right);
+        unlinked_.push_back(node);
+        if(left == nullptr || right == nullptr) {
+            //readers already inside node still see its child
+            slot.store(left != nullptr ? left : right, std::memory_order_release);
+            return true;
+        }
+        //build the replacement unpublished: the successor's entry over a copy of the right subtree without it
+        std::atomic<CNode*> newRight(right);
+        CNode* successor = nullptr;
+        removeMin(newRight, successor);
+        CNode* replacement = new CNode(successor->key, successor->value, left, child(newRight));
+        fixHeight(replacement);
+        slot.store(replacement, std::memory_order_release);
+        removed = true;
+    }
+    if(removed) {
+        rebalance(slot);
+    }
+    return removed;
+}
+
+/**
+* Replaces the subtree in slot, which is not yet reachable by readers, by
+* one without its smallest node, which is returned in min. The nodes on
+* the way down to it are copied, since readers can still reach the
+* originals through the published tree.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::removeMin(std::atomic<CNode*>& slot, CNode*& min)
+{
+    CNode* node = child(slot);
+    unlinked_.push_back(node);
+    if(child(node->left) == nullptr) {
+        min = node;
+        slot.store(child(node->right), std::memory_order_relaxed);
+        return;
+    }
+    CNode* copy = new CNode(node->key, node->value, child(node->left), child(node->right));
+    copy->height = node->height;
+    slot.store(copy, std::memory_order_relaxed);
+    removeMin(copy->left, min);
+    rebalance(slot);
+}
+
+/**
+* Restores the AVL property at the node in slot, whose subtrees are
+* balanced and differ in height by at most 2.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::rebalance(std::atomic<CNode*>& slot)
+{
+    CNode* node = child(slot);
+    int balance = height(child(node->right)) - height(child(node->left));
+    if(balance > 1) {
+        CNode* right = child(node->right);
+        if(height(child(right->left)) > height(child(right->right))) {
+            rotateRight(node->right);
+        }
+        rotateLeft(slot);
+    }
+    else if(balance < -1) {
+        CNode* left = child(node->left);
+        if(height(child(left->right)) > height(child(left->left))) {
+            rotateLeft(node->left);
+        }
+        rotateRight(slot);
+    }
+    else {
+        fixHeight(node);
+    }
+}
+
+/**
+* Rotates the node in slot left by publishing copies of it and its right
+* child. The originals keep their links for readers already inside them.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::rotateLeft(std::atomic<CNode*>& slot)
+{
+    CNode* node = child(slot);
+    CNode* right = child(node->right);
+    CNode* lower = new CNode(node->key, node->value, child(node->left), child(right->left));
+    fixHeight(lower);
+    CNode* upper = new CNode(right->key, right->value, lower, child(right->right));
+    fixHeight(upper);
+    slot.store(upper, std::memory_order_release);
+    unlinked_.push_back(node);
+    unlinked_.push_back(right);
+}
+
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::rotateRight(std::atomic<CNode*>& slot)
+{
+    CNode* node = child(slot);
+    CNode* left = child(node->left);
+    CNode* lower = new CNode(node->key, node->value, child(left->right), child(node->right));
+    fixHeight(lower);
+    CNode* upper = new CNode(left->key, left->value, child(left->left), lower);
+    fixHeight(upper);
+    slot.store(upper, std::memory_order_release);
+    unlinked_.push_back(node);
+    unlinked_.push_back(left);
+}
+
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::fixHeight(CNode* node)
+{
+    node->height = 1 + std::max(height(child(node->left)), height(child(node->right)));
+}
+
+/**
+* Retires the nodes the write unlinked, now that it has published the
+* tree without them, and frees a batch once enough have piled up.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::finishWrite()
+{
+    uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < unlinked_.size(); ++i) {
+        Retired retired = { unlinked_[i], epoch };
+        retired_.push_back(retired);
+    }
+    unlinked_.clear();
+    if(retired_.size() >= RECLAIM_BATCH) {
+        collect();
+    }
+}
+
+/**
+* Frees every retired node that no active reader can still hold, such as
+* the last few left over after writes stop.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::reclaim()
+{
+    std::lock_guard<std::mutex> lock(writer_);
+    collect();
+}
+
+/**
+* Starts a new epoch and frees the retired nodes from before the oldest
+* epoch an active reader announced. The caller holds the writer lock.
+*/
+template<typename Key, typename Value>
+void ConcurrentAVLTree<Key, Value>::collect()
+{
+    //nodes retired before this increment are unreachable to readers announcing the new epoch
+    epoch_.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = READER_IDLE;
+    for(size_t i = 0; i < readers_.size(); ++i) {
+        oldest = std::min(oldest, readers_[i].epoch.load(std::memory_order_acquire));
+    }
+    size_t freed = 0;
+    while(freed < retired_.size() && retired_[freed].epoch < oldest) {
+        delete retired_[freed].node;
+        ++freed;
+    }
+    retired_.erase(retired_.begin(), retired_.begin() + freed);
+}
+
+/**
+* Checks order, stored heights and balance of the whole tree under the
+* writer lock. For tests and debugging.
+*/
+template<typename Key, typename Value>
+bool ConcurrentAVLTree<Key, Value>::verify() const
+{
+    std::lock_guard<std::mutex> lock(writer_);
+    return verify(root_.load(std::memory_order_relaxed), nullptr, nullptr) >= 0;
+}
+
+// Returns the height of node's subtree, or -1 if it is not a valid AVL tree within (lo, hi)
+template<typename Key, typename Value>
+int ConcurrentAVLTree<Key, Value>::verify(const CNode* node, const Key* lo, const Key* hi)
+{
+    if(node == nullptr) {
+        return 0;
+    }
+    if((lo != nullptr && !(*lo < node->key)) || (hi != nullptr && !(node->key < *hi))) {
+        return -1;
+    }
+    int left = verify(child(node->left), lo, &node->key);
+    int right = verify(child(node->right), &node->key, hi);
+    if(left < 0 || right < 0 || left - right > 1 || right - left > 1) {
+        return -1;
+    }
+    int h = 1 + std::max(left, right);
+    return h == node->height ? h : -1;
+}
+
+#endif
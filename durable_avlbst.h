@@ -0,0 +1,621 @@
+#ifndef DURABLE_AVLBST_H
+#define DURABLE_AVLBST_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "avlbst.h"
+
+/**
+* When DurableAVLTree forces its log to disk.
+*
+* syncEveryOps: an insert/remove does not return until its log record is on
+*   disk once this many records are pending. 1 makes every operation durable
+*   before it returns; concurrent callers then share one fsync (group commit).
+*   0 disables count based syncing.
+* syncIntervalMs: a background thread syncs pending records at this period,
+*   bounding how much acknowledged work a crash can lose. 0 disables it.
+* snapshotEveryOps: after this many logged operations a background snapshot
+*   of the tree is written and older log segments are deleted. 0 disables it.
+*/
+struct DurabilityPolicy
+{
+    size_t syncEveryOps;
+    unsigned syncIntervalMs;
+    size_t snapshotEveryOps;
+
+    DurabilityPolicy(size_t syncOps = 1, unsigned intervalMs = 0, size_t snapshotOps = 1000000) :
+        syncEveryOps(syncOps), syncIntervalMs(intervalMs), snapshotEveryOps(snapshotOps)
+    {
+    }
+};
+
+/**
+* Header at the start of every write-ahead log segment.
+*/
+struct WALSegmentHeader
+{
+    char magic[4];          // "AVLW"
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueSize;
+};
+
+static const char WAL_SEGMENT_MAGIC[4] = {'A', 'V', 'L', 'W'};
+static const uint32_t WAL_SEGMENT_VERSION = 1;
+
+/**
+* An AVLTree whose contents survive crashes. Every insert/remove is applied to
+* the in-memory tree and appended to a write-ahead log in dir; the log is split
+* into numbered segments (log.<n>) and snapshots (snapshot.<n>, in the format of
+* AVLTree::save) cover everything logged before segment n. Opening the store
+* loads the newest snapshot and replays the log segments after it, stopping at
+* the first torn or corrupt record of a segment.
+*
+* All public member functions are safe to call from several threads.
+* Key and Value must be trivially copyable.
+*/
+template <typename Key, typename Value>
+class DurableAVLTree
+{
+public:
+    DurableAVLTree(const std::string& dir, const DurabilityPolicy& policy = DurabilityPolicy());
+    ~DurableAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    bool find(const Key& key, Value& value) const;
+    void sync();
+    void snapshot();
+
+private:
+    DurableAVLTree(const DurableAVLTree&);
+    DurableAVLTree& operator=(const DurableAVLTree&);
+
+    enum { OP_INSERT = 1, OP_REMOVE = 2 };
+    static const size_t RECORD_SIZE = sizeof(uint32_t) + 1 + sizeof(Key) + sizeof(Value);
+
+    static uint32_t checksum(const char* data, size_t length);
+    static void writeAll(int fd, const char* data, size_t length, const std::string& what);
+    static void syncDirectory(const std::string& dir);
+    std::string segmentPath(uint64_t segment) const;
+    std::string snapshotPath(uint64_t segment) const;
+
+    void recover();
+    void replaySegment(uint64_t segment);
+    void openSegment(uint64_t segment);
+    void append(char op, const Key& key, const Value* value, std::unique_lock<std::mutex>& lock);
+    void waitDurable(uint64_t lsn, std::unique_lock<std::mutex>& lock);
+    void writeSnapshot(std::unique_lock<std::mutex>& lock);
+    void backgroundLoop();
+    void checkFailed() const;
+
+    std::string dir_;
+    DurabilityPolicy policy_;
+    AVLTree<Key, Value> tree_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable durableCv_;
+    std::condition_variable backgroundCv_;
+    std::thread background_;
+
+    int logFd_;
+    uint64_t segment_;
+    uint64_t oldestSegment_;        // no log or snapshot file is numbered below this
+    std::vector<char> pending_;     // records appended but not yet written
+    uint64_t appendedLsn_;
+    uint64_t durableLsn_;
+    bool syncing_;                  // a thread is writing/syncing outside the lock
+    bool snapshotting_;
+    bool snapshotRequested_;
+    size_t opsSinceSnapshot_;
+    bool stopping_;
+    std::string failure_;
+};
+
+/**
+* Opens (creating if needed) the store in dir and recovers its contents.
+* Throws std::runtime_error if the directory or its files cannot be used.
+*/
+template<typename Key, typename Value>
+DurableAVLTree<Key, Value>::DurableAVLTree(const std::string& dir, const DurabilityPolicy& policy) :
+    dir_(dir), policy_(policy), logFd_(-1), segment_(0), oldestSegment_(0), appendedLsn_(0), durableLsn_(0),
+    syncing_(false), snapshotting_(false), snapshotRequested_(false), opsSinceSnapshot_(0), stopping_(false)
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "DurableAVLTree requires trivially copyable Key and Value");
+
+    if(mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Cannot create " + dir_);
+    }
+    recover();
+    background_ = std::thread(&DurableAVLTree<Key, Value>::backgroundLoop, this);
+}
+
+/**
+* Stops the background thread and makes every logged operation durable.
+*/
+template<typename Key, typename Value>
+DurableAVLTree<Key, Value>::~DurableAVLTree()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    backgroundCv_.notify_all();
+    background_.join();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    try {
+        waitDurable(appendedLsn_, lock);
+    }
+    catch(const std::exception&) {
+        // nothing more can be done from a destructor; unsynced records are lost
+    }
+    close(logFd_);
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    checkFailed();
+    tree_.insert(keyValuePair);
+    append(OP_INSERT, keyValuePair.first, &keyValuePair.second, lock);
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::remove(const Key& key)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    checkFailed();
+    tree_.remove(key);
+    append(OP_REMOVE, key, NULL, lock);
+}
+
+/**
+* Copies the value stored under key into value and returns true, or returns
+* false if the key is not present.
+*/
+template<typename Key, typename Value>
+bool DurableAVLTree<Key, Value>::find(const Key& key, Value& value) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    typename AVLTree<Key, Value>::iterator it = tree_.find(key);
+    if(it == tree_.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+/**
+* Blocks until every operation that has returned so far is on disk.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::sync()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    checkFailed();
+    waitDurable(appendedLsn_, lock);
+}
+
+/**
+* Writes a snapshot now on the calling thread instead of waiting for the
+* background thread to do it.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::snapshot()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    checkFailed();
+    writeSnapshot(lock);
+}
+
+/**
+* Appends one log record for an operation already applied to the tree and,
+* if the policy asks for it, waits for the record to reach the disk.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::append(char op, const Key& key, const Value* value, std::unique_lock<std::mutex>& lock)
+{
+    char record[RECORD_SIZE];
+    std::memset(record, 0, sizeof(record));
+    record[sizeof(uint32_t)] = op;
+    std::memcpy(record + sizeof(uint32_t) + 1, &key, sizeof(Key));
+    if(value != NULL) {
+        std::memcpy(record + sizeof(uint32_t) + 1 + sizeof(Key), value, sizeof(Value));
+    }
+    uint32_t sum = checksum(record + sizeof(uint32_t), RECORD_SIZE - sizeof(uint32_t));
+    std::memcpy(record, &sum, sizeof(sum));
+    pending_.insert(pending_.end(), record, record + RECORD_SIZE);
+    uint64_t lsn = ++appendedLsn_;
+
+    if(policy_.snapshotEveryOps != 0 && ++opsSinceSnapshot_ >= policy_.snapshotEveryOps && !snapshotRequested_) {
+        snapshotRequested_ = true;
+        backgroundCv_.notify_all();
+    }
+    if(policy_.syncEveryOps != 0 && lsn - durableLsn_ >= policy_.syncEveryOps) {
+        waitDurable(lsn, lock);
+    }
+}
+
+/**
+* Returns once the record with sequence number lsn is on disk. The first
+* waiter becomes the leader and writes and syncs everything pending outside
+* the lock; records appended meanwhile are picked up by the next leader, so
+* one fsync covers every writer that queued behind it (group commit).
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::waitDurable(uint64_t lsn, std::unique_lock<std::mutex>& lock)
+{
+    while(durableLsn_ < lsn) {
+        if(syncing_) {
+            durableCv_.wait(lock);
+            continue;
+        }
+        syncing_ = true;
+        std::vector<char> batch;
+        batch.swap(pending_);
+        uint64_t target = appendedLsn_;
+        int fd = logFd_;
+        std::string path = segmentPath(segment_);
+        lock.unlock();
+
+        std::string error;
+        try {
+            writeAll(fd, batch.empty() ? NULL : &batch[0], batch.size(), path);
+            if(fdatasync(fd) != 0) {
+                error = "fdatasync failed on " + path;
+            }
+        }
+        catch(const std::exception& e) {
+            error = e.what();
+        }
+
+        lock.lock();
+        syncing_ = false;
+        if(error.empty()) {
+            durableLsn_ = std::max(durableLsn_, target);
+        }
+        else if(failure_.empty()) {
+            failure_ = error;
+        }
+        durableCv_.notify_all();
+        if(!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+}
+
+/**
+* Takes a consistent copy of the tree, starts a new log segment, and writes
+* the copy as snapshot.<segment> without holding the lock. Segments and
+* snapshots older than the new snapshot are deleted once it is durable.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::writeSnapshot(std::unique_lock<std::mutex>& lock)
+{
+    while(snapshotting_) {
+        durableCv_.wait(lock);
+    }
+    snapshotting_ = true;
+    snapshotRequested_ = false;
+    opsSinceSnapshot_ = 0;
+
+    std::string error;
+    uint64_t covered = 0;
+    AVLTree<Key, Value>* copy = NULL;
+    try {
+        // everything in the old segment must be on disk before it is closed
+        while(syncing_ or durableLsn_ < appendedLsn_) {
+            if(syncing_) {
+                durableCv_.wait(lock);
+            }
+            else {
+                waitDurable(appendedLsn_, lock);
+            }
+        }
+        copy = new AVLTree<Key, Value>(tree_);
+        int oldFd = logFd_;
+        openSegment(segment_ + 1);
+        close(oldFd);
+        covered = segment_;
+    }
+    catch(const std::exception& e) {
+        error = e.what();
+    }
+
+    if(error.empty()) {
+        lock.unlock();
+        try {
+            std::string path = snapshotPath(covered);
+            std::string tmpPath = path + ".tmp";
+            {
+                std::ofstream out(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+                copy->save(out);
+                out.close();
+                if(!out) {
+                    throw std::runtime_error("Cannot write " + tmpPath);
+                }
+            }
+            int fd = open(tmpPath.c_str(), O_RDONLY);
+            bool ok = fd >= 0 && fsync(fd) == 0;
+            if(fd >= 0) {
+                close(fd);
+            }
+            if(!ok or rename(tmpPath.c_str(), path.c_str()) != 0) {
+                throw std::runtime_error("Cannot commit " + path);
+            }
+            syncDirectory(dir_);
+
+            for(uint64_t s = oldestSegment_; s < covered; ++s) {
+                unlink(segmentPath(s).c_str());
+                unlink(snapshotPath(s).c_str());
+            }
+            oldestSegment_ = covered;
+        }
+        catch(const std::exception& e) {
+            error = e.what();
+        }
+        lock.lock();
+    }
+    delete copy;
+    snapshotting_ = false;
+    durableCv_.notify_all();
+    if(!error.empty()) {
+        if(failure_.empty()) {
+            failure_ = error;
+        }
+        throw std::runtime_error(error);
+    }
+}
+
+/**
+* Runs the periodic sync and the requested snapshots.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::backgroundLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    // a snapshot requested while the last one was being written was never
+    // notified to a waiter, so the flag itself is what the wait checks
+    auto woken = [this]() { return stopping_ or (snapshotRequested_ and failure_.empty()); };
+    while(!stopping_) {
+        if(policy_.syncIntervalMs != 0) {
+            backgroundCv_.wait_for(lock, std::chrono::milliseconds(policy_.syncIntervalMs), woken);
+        }
+        else {
+            backgroundCv_.wait(lock, woken);
+        }
+        if(stopping_ or !failure_.empty()) {
+            continue;
+        }
+        try {
+            if(snapshotRequested_) {
+                writeSnapshot(lock);
+            }
+            if(policy_.syncIntervalMs != 0 && durableLsn_ < appendedLsn_) {
+                waitDurable(appendedLsn_, lock);
+            }
+        }
+        catch(const std::exception&) {
+            // failure_ is set and reported by the next call on the store
+        }
+    }
+}
+
+/**
+* Loads the newest snapshot and replays the log segments written after it,
+* then starts a fresh segment for new operations.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::recover()
+{
+    std::vector<uint64_t> segments;
+    uint64_t latestSnapshot = 0;
+    bool haveSnapshot = false;
+    DIR* dir = opendir(dir_.c_str());
+    if(dir == NULL) {
+        throw std::runtime_error("Cannot read " + dir_);
+    }
+    for(struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        char* end = NULL;
+        if(std::strncmp(name, "log.", 4) == 0) {
+            uint64_t n = std::strtoull(name + 4, &end, 10);
+            if(end != name + 4 && *end == '\0') {
+                segments.push_back(n);
+            }
+        }
+        else if(std::strncmp(name, "snapshot.", 9) == 0) {
+            uint64_t n = std::strtoull(name + 9, &end, 10);
+            if(end != name + 9 && *end == '\0' && (!haveSnapshot || n > latestSnapshot)) {
+                latestSnapshot = n;
+                haveSnapshot = true;
+            }
+        }
+    }
+    closedir(dir);
+    std::sort(segments.begin(), segments.end());
+
+    if(haveSnapshot) {
+        std::ifstream in(snapshotPath(latestSnapshot).c_str(), std::ios::binary);
+        tree_.load(in);
+    }
+    uint64_t next = haveSnapshot ? latestSnapshot : 0;
+    oldestSegment_ = segments.empty() ? next : std::min(next, segments.front());
+    for(size_t i = 0; i < segments.size(); ++i) {
+        if(!haveSnapshot || segments[i] >= latestSnapshot) {
+            replaySegment(segments[i]);
+        }
+        next = std::max(next, segments[i] + 1);
+    }
+    openSegment(next);
+}
+
+/**
+* Applies the valid records of one segment to the tree. A record that is
+* short or fails its checksum ends the segment: it is the tail of a write
+* that was interrupted by the crash.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::replaySegment(uint64_t segment)
+{
+    std::ifstream in(segmentPath(segment).c_str(), std::ios::binary);
+    WALSegmentHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(in.gcount() != sizeof(header)) {
+        return;
+    }
+    if(std::memcmp(header.magic, WAL_SEGMENT_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != WAL_SEGMENT_VERSION ||
+       header.keySize != sizeof(Key) || header.valueSize != sizeof(Value)) {
+        throw std::runtime_error("Log segment " + segmentPath(segment) + " does not match this tree");
+    }
+
+    std::vector<char> buffer(RECORD_SIZE * 4096);
+    size_t carried = 0;
+    while(true) {
+        in.read(&buffer[carried], buffer.size() - carried);
+        size_t available = carried + static_cast<size_t>(in.gcount());
+        size_t pos = 0;
+        for(; pos + RECORD_SIZE <= available; pos += RECORD_SIZE) {
+            const char* record = &buffer[pos];
+            uint32_t sum;
+            std::memcpy(&sum, record, sizeof(sum));
+            if(sum != checksum(record + sizeof(uint32_t), RECORD_SIZE - sizeof(uint32_t))) {
+                return;
+            }
+            typename std::aligned_storage<sizeof(Key), alignof(Key)>::type key;
+            std::memcpy(&key, record + sizeof(uint32_t) + 1, sizeof(Key));
+            if(record[sizeof(uint32_t)] == OP_INSERT) {
+                typename std::aligned_storage<sizeof(Value), alignof(Value)>::type value;
+                std::memcpy(&value, record + sizeof(uint32_t) + 1 + sizeof(Key), sizeof(Value));
+                tree_.insert(std::make_pair(*reinterpret_cast<Key*>(&key), *reinterpret_cast<Value*>(&value)));
+            }
+            else if(record[sizeof(uint32_t)] == OP_REMOVE) {
+                tree_.remove(*reinterpret_cast<Key*>(&key));
+            }
+            else {
+                return;
+            }
+        }
+        if(!in) {
+            return;
+        }
+        carried = available - pos;
+        std::memmove(&buffer[0], &buffer[pos], carried);
+    }
+}
+
+/**
+* Creates log segment number segment and makes it the one appended to.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::openSegment(uint64_t segment)
+{
+    std::string path = segmentPath(segment);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(fd < 0) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    WALSegmentHeader header;
+    std::memcpy(header.magic, WAL_SEGMENT_MAGIC, sizeof(header.magic));
+    header.version = WAL_SEGMENT_VERSION;
+    header.keySize = sizeof(Key);
+    header.valueSize = sizeof(Value);
+    try {
+        writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header), path);
+        if(fdatasync(fd) != 0) {
+            throw std::runtime_error("fdatasync failed on " + path);
+        }
+        syncDirectory(dir_);
+    }
+    catch(...) {
+        close(fd);
+        throw;
+    }
+    logFd_ = fd;
+    segment_ = segment;
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::checkFailed() const
+{
+    if(!failure_.empty()) {
+        throw std::runtime_error("Durable tree is unusable: " + failure_);
+    }
+}
+
+// FNV-1a, enough to tell a torn record from a complete one
+template<typename Key, typename Value>
+uint32_t DurableAVLTree<Key, Value>::checksum(const char* data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::writeAll(int fd, const char* data, size_t length, const std::string& what)
+{
+    while(length > 0) {
+        ssize_t written = write(fd, data, length);
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Cannot write " + what);
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+// Makes file creations and renames in dir durable
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::syncDirectory(const std::string& dir)
+{
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd < 0) {
+        throw std::runtime_error("Cannot open " + dir);
+    }
+    int result = fsync(fd);
+    close(fd);
+    if(result != 0) {
+        throw std::runtime_error("Cannot sync " + dir);
+    }
+}
+
+template<typename Key, typename Value>
+std::string DurableAVLTree<Key, Value>::segmentPath(uint64_t segment) const
+{
+    return dir_ + "/log." + std::to_string(segment);
+}
+
+template<typename Key, typename Value>
+std::string DurableAVLTree<Key, Value>::snapshotPath(uint64_t segment) const
+{
+    return dir_ + "/snapshot." + std::to_string(segment);
+}
+
+#endif
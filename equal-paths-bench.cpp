@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "flat-tree.h"
+
+using namespace std;
+
+// Builds the largest perfect tree with at most n nodes, so every leaf is at
+// the same depth and equalPaths has to look at the whole tree.
+static Node* buildPerfect(size_t n, vector<Node*>& nodes)
+{
+    size_t count = 1;
+    while(2 * count + 1 <= n) {
+        count = 2 * count + 1;
+    }
+    for(size_t i = 0; i < count; ++i) {
+        nodes.push_back(new Node(static_cast<int>(i)));
+    }
+    for(size_t i = 0; 2 * i + 2 < count; ++i) {
+        nodes[i]->left = nodes[2 * i + 1];
+        nodes[i]->right = nodes[2 * i + 2];
+    }
+    return nodes.empty() ? NULL : nodes[0];
+}
+
+// Builds an unbalanced BST shape by inserting n random keys.
+static Node* buildRandom(size_t n, vector<Node*>& nodes)
+{
+    vector<uint64_t> keys = makeKeys("random", n, 7);
+    Node* root = NULL;
+    for(size_t i = 0; i < n; ++i) {
+        Node* node = new Node(static_cast<int>(keys[i]));
+        nodes.push_back(node);
+        Node** link = &root;
+        while(*link != NULL) {
+            link = node->key < (*link)->key ? &(*link)->left : &(*link)->right;
+        }
+        *link = node;
+    }
+    return root;
+}
+
+/**
+* Times equalPaths on a perfect tree (answer true after visiting every node)
+* and on a random tree (answer false, usually found early), then
+* equalPathsParallel and the FlatTree queries on the same trees, and
+* equalPathsBatch on a forest of small perfect trees with the same total size.
+*/
+void benchEqualPaths(const vector<size_t>& sizes, unsigned reps)
+{
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        for(int shape = 0; shape < 2; ++shape) {
+            vector<Node*> nodes;
+            Node* root = shape == 0 ? buildPerfect(sizes[i], nodes) : buildRandom(sizes[i], nodes);
+            LatencySamples latency;
+            double secs = 0;
+            for(unsigned r = 0; r < reps; ++r) {
+                Clock::time_point start = Clock::now();
+                equalPaths(root);
+                uint64_t nanos = nanosSince(start);
+                secs += nanos / 1e9;
+                latency.add(nanos);
+            }
+            report("equalpaths", "equal-paths", shape == 0 ? "perfect" : "random", nodes.size(),
+                   "equalPaths", secs, reps, &latency);
+
+            latency = LatencySamples();
+            secs = 0;
+            for(unsigned r = 0; r < reps; ++r) {
+                Clock::time_point start = Clock::now();
+                equalPathsParallel(root);
+                uint64_t nanos = nanosSince(start);
+                secs += nanos / 1e9;
+                latency.add(nanos);
+            }
+            report("equalpaths", "equal-paths", shape == 0 ? "perfect" : "random", nodes.size(),
+                   "equalPathsParallel", secs, reps, &latency);
+
+            Clock::time_point start = Clock::now();
+            FlatTree flat = flattenTree(root);
+            report("equalpaths", "flat-tree", shape == 0 ? "perfect" : "random", nodes.size(),
+                   "flattenTree", secondsSince(start), 1);
+            latency = LatencySamples();
+            secs = 0;
+            for(unsigned r = 0; r < reps; ++r) {
+                start = Clock::now();
+                equalPaths(flat);
+                uint64_t nanos = nanosSince(start);
+                secs += nanos / 1e9;
+                latency.add(nanos);
+            }
+            report("equalpaths", "flat-tree", shape == 0 ? "perfect" : "random", nodes.size(),
+                   "equalPaths", secs, reps, &latency);
+            start = Clock::now();
+            for(unsigned r = 0; r < reps; ++r) {
+                leafDepthHistogram(flat);
+            }
+            report("equalpaths", "flat-tree", shape == 0 ? "perfect" : "random", nodes.size(),
+                   "leafDepthHistogram", secondsSince(start), reps);
+            for(size_t j = 0; j < nodes.size(); ++j) {
+                delete nodes[j];
+            }
+        }
+
+        // a forest of 1023-node perfect trees
+        vector<Node*> nodes;
+        vector<Node*> roots;
+        for(size_t total = 0; total + 1023 <= sizes[i]; total += 1023) {
+            vector<Node*> treeNodes;
+            roots.push_back(buildPerfect(1023, treeNodes));
+            nodes.insert(nodes.end(), treeNodes.begin(), treeNodes.end());
+        }
+        if(roots.empty()) {
+            continue;
+        }
+        bool* out = new bool[roots.size()];
+        Clock::time_point start = Clock::now();
+        for(unsigned r = 0; r < reps; ++r) {
+            for(size_t j = 0; j < roots.size(); ++j) {
+                out[j] = equalPaths(roots[j]);
+            }
+        }
+        report("equalpaths", "equal-paths", "forest", nodes.size(), "equalPaths-loop",
+               secondsSince(start), static_cast<double>(reps) * roots.size());
+        start = Clock::now();
+        for(unsigned r = 0; r < reps; ++r) {
+            equalPathsBatch(&roots[0], roots.size(), out);
+        }
+        report("equalpaths", "equal-paths", "forest", nodes.size(), "equalPathsBatch",
+               secondsSince(start), static_cast<double>(reps) * roots.size());
+        delete [] out;
+        for(size_t j = 0; j < nodes.size(); ++j) {
+            delete nodes[j];
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+// Multithreaded variants of equalPaths, kept out of the provided equal-paths.h
+#include "equal-paths.h"
+
+/**
+ * @brief Runs equalPaths on each of the n trees in roots, writing the answer
+ *        for roots[i] to out[i]. Trees are spread over threads threads
+ *        (0 means one per hardware thread).
+ */
+void equalPathsBatch(Node* const* roots, size_t n, bool* out, unsigned threads = 0);
+
+/**
+ * @brief equalPaths for a single large tree on threads threads (0 means one
+ *        per hardware thread). Subtrees below a shallow split depth are checked
+ *        as separate tasks, and the remaining tasks are cancelled as soon as
+ *        one finds a leaf at the wrong depth.
+ */
+bool equalPathsParallel(Node* root, unsigned threads = 0);
+
+#endif
@@ -1,8 +1,51 @@
 #include <iostream>
 #include <cstdlib>
+#include <vector>
 #include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "flat-tree.h"
 using namespace std;
 
+int failures = 0;
+
+size_t countNodes(Node* root)
+{
+  return root == NULL ? 0 : 1 + countNodes(root->left) + countNodes(root->right);
+}
+
+// Leaves below root, root at depth 0, counted into histogram
+void countLeaves(Node* root, size_t depth, vector<size_t>& histogram)
+{
+  if (root == NULL) {
+    return;
+  }
+  if (root->left == NULL and root->right == NULL) {
+    if (histogram.size() <= depth) {
+      histogram.resize(depth + 1, 0);
+    }
+    ++histogram[depth];
+    return;
+  }
+  countLeaves(root->left, depth + 1, histogram);
+  countLeaves(root->right, depth + 1, histogram);
+}
+
+// Checks the FlatTree queries against the pointer-based ones on the same tree
+void checkFlat(const char* msg, Node* root)
+{
+  FlatTree flat = flattenTree(root);
+  vector<size_t> histogram;
+  countLeaves(root, 0, histogram);
+  bool ok = flat.size() == countNodes(root) and
+            equalPaths(flat) == equalPaths(root) and
+            treeHeight(flat) == depthLength(root) and
+            leafDepthHistogram(flat) == histogram;
+  if (!ok) {
+    ++failures;
+  }
+  cout << msg << " flat: " << (ok ? "matches" : "MISMATCH") << endl;
+}
+
 
 Node* a;
 Node* b;
@@ -22,6 +65,7 @@ void test1(const char* msg)
 {
   setNode(a,1,NULL, NULL);
   cout << msg << ": " <<   equalPaths(a) << endl;
+  checkFlat(msg, a);
 }
 
 void test2(const char* msg)
@@ -29,6 +73,7 @@ void test2(const char* msg)
   setNode(a,1,b,NULL);
   setNode(b,2,NULL,NULL);
   cout << msg << ": " <<   equalPaths(a) << endl;
+  checkFlat(msg, a);
 }
 
 void test3(const char* msg)
@@ -37,6 +82,7 @@ void test3(const char* msg)
   setNode(b,2,NULL,NULL);
   setNode(c,3,NULL,NULL);
   cout << msg << ": " <<   equalPaths(a) << endl;
+  checkFlat(msg, a);
 }
 
 void test4(const char* msg)
@@ -44,6 +90,7 @@ void test4(const char* msg)
   setNode(a,1,NULL,c);
   setNode(c,3,NULL,NULL);
   cout << msg << ": " <<   equalPaths(a) << endl;
+  checkFlat(msg, a);
 }
 
 void test5(const char* msg)
@@ -53,6 +100,31 @@ void test5(const char* msg)
   setNode(c,3,NULL,NULL);
   setNode(d,4,NULL,NULL);
   cout << msg << ": " <<   equalPaths(a) << endl;
+  checkFlat(msg, a);
+}
+
+void test6(const char* msg)
+{
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,NULL);
+  setNode(c,3,NULL,d);
+  setNode(d,4,NULL,NULL);
+  Node* roots[] = {a, c, d};
+  bool out[3];
+  equalPathsBatch(roots, 3, out);
+  cout << msg << ": " <<   equalPathsParallel(a) << " " << out[0] << out[1] << out[2] << endl;
+  checkFlat(msg, a);
+  checkFlat(msg, c);
+}
+
+void test7(const char* msg)
+{
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,d);
+  setNode(c,3,NULL,NULL);
+  setNode(d,4,NULL,NULL);
+  cout << msg << ": " << depthLength(a) << " " << equalCheck(a, 1, 3) << equalCheck(b, 2, 3) << equalCheck(c, 2, 2) << endl;
+  checkFlat(msg, a);
 }
 
 int main()
@@ -67,10 +139,14 @@ int main()
   test3("Test3");
   test4("Test4");
   test5("Test5");
+  test6("Test6");
+  test7("Test7");
+  checkFlat("Empty", NULL);
  
   delete a;
   delete b;
   delete c;
   delete d;
+  return failures == 0 ? 0 : 1;
 }
 
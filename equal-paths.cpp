@@ -1,15 +1,24 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
 #include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+#include "bst_parallel.h"
 #endif
 
 #include "equal-paths.h"
+#include "equal-paths-parallel.h"
 using namespace std;
 
 
 // You may add any prototypes of helper functions here
-int depthLength(Node* root); 
-bool equalCheck(Node* root, int length, int goalLength);
+
+// Pending right subtrees kept in a local array before spilling to the heap
+static const size_t LOCAL_PENDING = 64;
+// Trees handed to a thread at a time by equalPathsBatch
+static const size_t BATCH_CHUNK = 16;
+static bool equalPathsFrom(Node* root, int rootLength, int& goalLength, const atomic<bool>* cancel);
 
 
 
@@ -21,53 +30,203 @@ bool equalPaths(Node * root)
     if (root == nullptr){
         return true; 
     }
-
-    //calculate the max depth with the depthLength helper function
-    int maxDepth = depthLength(root);
-
-    //check to see if the tree reaches the maxDepth 
-    return equalCheck(root, 1, maxDepth);
-
+    int goalLength = 0;
+    return equalPathsFrom(root, 1, goalLength, nullptr);
 }
 
-
+/**
+ * The number of nodes on the longest root to leaf path, 0 for an empty
+ * tree. Iterative like equalPathsFrom, so deep trees cannot overflow the
+ * call stack.
+ */
 int depthLength(Node* root) {
-  //if there is only the root return 0
     if (root == nullptr) {
-        return 0; 
+        return 0;
     }
-    //get the height of the left and right subtrees recursively
-    int leftTree = depthLength(root->left);
-    int rightTree = depthLength(root->right);
-
-    //get the final height of whatever is the longest root->leaf node path 
-    return 1 + max(leftTree, rightTree);
+    int deepest = 0;
+    vector<pair<Node*, int> > pending(1, make_pair(root, 1));
+    while (!pending.empty()) {
+        Node* node = pending.back().first;
+        int length = pending.back().second;
+        pending.pop_back();
+        deepest = max(deepest, length);
+        if (node->left != nullptr) {
+            pending.push_back(make_pair(node->left, length + 1));
+        }
+        if (node->right != nullptr) {
+            pending.push_back(make_pair(node->right, length + 1));
+        }
+    }
+    return deepest;
 }
 
+/**
+ * True if every leaf below root is at depth goalLength, where root itself
+ * is at depth length (1 for a whole tree). The single-pass walk with its
+ * goal fixed up front.
+ */
 bool equalCheck(Node* root, int length, int goalLength) {
     if (root == nullptr) {
-        return true; 
+        return true;
     }
-    //check if you are at a leaf node
-    if (root->left == nullptr and root->right == nullptr) {
-      //if the lenght is not the same as the goal length, it is not balanced
-        if (length != goalLength) {
+    //every leaf below root is at least as deep as root
+    if (goalLength < length) {
+        return false;
+    }
+    return equalPathsFrom(root, length, goalLength, nullptr);
+}
+
+/**
+ * Walks the tree once, depth first, with an explicit stack instead of
+ * recursion so deep trees cannot overflow the call stack. Only right
+ * children still to be visited are pushed, at most one per level, so the
+ * stack is bounded by the height of the tree. The depth of the first leaf
+ * found is the goal; the walk stops at the first leaf at another depth, or
+ * at the first inner node already at the goal depth (every leaf below it
+ * would be deeper).
+ *
+ * root is at depth rootLength. goalLength is the leaf depth every leaf must
+ * have, or 0 if not yet known, in which case the first leaf sets it. If
+ * cancel is not NULL it is polled every 1024 nodes, and the walk gives up
+ * (returning false) once it is set.
+ */
+static bool equalPathsFrom(Node* root, int rootLength, int& goalLength, const atomic<bool>* cancel)
+{
+    //right subtrees still to visit; the local array covers most trees
+    //and the vector takes over only for deeper ones
+    pair<Node*, int> local[LOCAL_PENDING];
+    vector<pair<Node*, int> > overflow;
+    size_t pending = 0;
+    Node* node = root;
+    int length = rootLength;
+    size_t visited = 0;
+
+    while (true) {
+        if (cancel != nullptr and (++visited & 1023) == 0 and cancel->load(memory_order_relaxed)) {
+            return false;
+        }
+        //check if you are at a leaf node
+        if (node->left == nullptr and node->right == nullptr) {
+          //the first leaf sets the length every other leaf must match
+            if (goalLength == 0) {
+                goalLength = length;
+            }
+            else if (length != goalLength) {
+                return false;
+            }
+            if (pending == 0) {
+                return true;
+            }
+            --pending;
+            const pair<Node*, int>& next = pending < LOCAL_PENDING ? local[pending] : overflow[pending - LOCAL_PENDING];
+            node = next.first;
+            length = next.second;
+            if (pending >= LOCAL_PENDING) {
+                overflow.pop_back();
+            }
+            continue;
+        }
+        //an inner node at the goal length can only have deeper leaves below it
+        if (goalLength != 0 and length >= goalLength) {
             return false;
         }
+
+        //go left first, leaving the right subtree for later. increment the length by 1
+        if (node->left != nullptr) {
+            if (node->right != nullptr) {
+                if (pending < LOCAL_PENDING) {
+                    local[pending] = make_pair(node->right, length + 1);
+                }
+                else {
+                    overflow.push_back(make_pair(node->right, length + 1));
+                }
+                ++pending;
+            }
+            node = node->left;
+        }
         else {
-            return true; 
+            node = node->right;
         }
+        ++length;
     }
+}
 
-    //check if the left node or right node are balanced. increment the overall length by 1
-    bool leftTreeEqual = equalCheck(root->left, length + 1, goalLength);
-    bool rightTreeEqual = equalCheck(root->right, length + 1, goalLength);
-
-    //see if both trees have equal heights 
-    return (leftTreeEqual and rightTreeEqual);
+void equalPathsBatch(Node* const* roots, size_t n, bool* out, unsigned threads)
+{
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    //hand out small chunks so tiny trees do not all contend on the same counter
+    parallelFor((n + BATCH_CHUNK - 1) / BATCH_CHUNK, threads, [&](size_t chunk) {
+        size_t end = min(n, (chunk + 1) * BATCH_CHUNK);
+        for (size_t i = chunk * BATCH_CHUNK; i < end; ++i) {
+            out[i] = equalPaths(roots[i]);
+        }
+    });
 }
 
+/**
+ * Walks the levels above splitDepth, collecting the leaves found there and
+ * the subtrees that start at splitDepth. Returns false on a mismatch among
+ * the leaves seen so far.
+ */
+static bool collectSubtrees(Node* node, int length, int splitDepth, int& goalLength,
+                            vector<pair<Node*, int> >& subtrees)
+{
+    if (node->left == nullptr and node->right == nullptr) {
+        if (goalLength == 0) {
+            goalLength = length;
+        }
+        return length == goalLength;
+    }
+    if (length == splitDepth) {
+        subtrees.push_back(make_pair(node, length));
+        return true;
+    }
+    return (node->left == nullptr or collectSubtrees(node->left, length + 1, splitDepth, goalLength, subtrees)) and
+           (node->right == nullptr or collectSubtrees(node->right, length + 1, splitDepth, goalLength, subtrees));
+}
 
+bool equalPathsParallel(Node* root, unsigned threads)
+{
+    if (root == nullptr) {
+        return true;
+    }
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    //about four subtrees per thread, so uneven subtrees still balance out
+    int splitDepth = 1;
+    while ((1u << (splitDepth - 1)) < 4 * threads and splitDepth < 30) {
+        ++splitDepth;
+    }
 
+    int topGoal = 0;
+    vector<pair<Node*, int> > subtrees;
+    if (!collectSubtrees(root, 1, splitDepth, topGoal, subtrees)) {
+        return false;
+    }
+    //a leaf above the split depth is shallower than any leaf in the subtrees
+    if (topGoal != 0) {
+        return subtrees.empty();
+    }
 
- 
\ No newline at end of file
+    //the first subtree to finish publishes its leaf depth; later ones start from it
+    atomic<int> sharedGoal(0);
+    atomic<bool> mismatch(false);
+    parallelFor(subtrees.size(), threads, [&](size_t i) {
+        if (mismatch.load(memory_order_relaxed)) {
+            return;
+        }
+        int goalLength = sharedGoal.load();
+        if (!equalPathsFrom(subtrees[i].first, subtrees[i].second, goalLength, &mismatch)) {
+            mismatch.store(true);
+            return;
+        }
+        int expected = 0;
+        if (!sharedGoal.compare_exchange_strong(expected, goalLength) and expected != goalLength) {
+            mismatch.store(true);
+        }
+    });
+    return !mismatch.load();
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <stdexcept>
+#include "flat-tree.h"
+using namespace std;
+
+// Nodes equalPaths checks between early exits
+static const size_t SCAN_BLOCK = 4096;
+
+FlatTree flattenTree(Node* root)
+{
+    FlatTree tree;
+    if (root == nullptr) {
+        tree.levelStart.push_back(0);
+        return tree;
+    }
+
+    //the pointer array doubles as the breadth-first queue
+    vector<Node*> order;
+    order.push_back(root);
+    tree.levelStart.push_back(0);
+    size_t levelEnd = 1;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i == levelEnd) {
+            tree.levelStart.push_back(static_cast<uint32_t>(i));
+            levelEnd = order.size();
+        }
+        Node* node = order[i];
+        if (order.size() + 2 > FLAT_NIL) {
+            throw length_error("Tree is too large to flatten");
+        }
+        tree.keys.push_back(node->key);
+        if (node->left != nullptr) {
+            tree.left.push_back(static_cast<uint32_t>(order.size()));
+            order.push_back(node->left);
+        }
+        else {
+            tree.left.push_back(FLAT_NIL);
+        }
+        if (node->right != nullptr) {
+            tree.right.push_back(static_cast<uint32_t>(order.size()));
+            order.push_back(node->right);
+        }
+        else {
+            tree.right.push_back(FLAT_NIL);
+        }
+    }
+    tree.levelStart.push_back(static_cast<uint32_t>(order.size()));
+    return tree;
+}
+
+/**
+ * A node is a leaf when both child indices are FLAT_NIL, which is the only
+ * case where their bitwise and is FLAT_NIL. The loops below count leaves
+ * without branching so the compiler can vectorize them.
+ */
+static size_t countLeaves(const FlatTree& tree, size_t begin, size_t end)
+{
+    const uint32_t* left = tree.left.data();
+    const uint32_t* right = tree.right.data();
+    size_t leaves = 0;
+    for (size_t i = begin; i < end; ++i) {
+        leaves += (left[i] & right[i]) == FLAT_NIL;
+    }
+    return leaves;
+}
+
+bool equalPaths(const FlatTree& tree)
+{
+    //every node on the last level is a leaf, so only leaves above it matter
+    if (tree.size() == 0) {
+        return true;
+    }
+    //scan in blocks so an early leaf ends the scan without losing the vectorized loop
+    size_t lastLevel = tree.levelStart[tree.levelStart.size() - 2];
+    for (size_t begin = 0; begin < lastLevel; begin += SCAN_BLOCK) {
+        if (countLeaves(tree, begin, min(lastLevel, begin + SCAN_BLOCK)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+vector<size_t> leafDepthHistogram(const FlatTree& tree)
+{
+    vector<size_t> histogram;
+    for (size_t d = 0; d + 1 < tree.levelStart.size(); ++d) {
+        histogram.push_back(countLeaves(tree, tree.levelStart[d], tree.levelStart[d + 1]));
+    }
+    return histogram;
+}
+
+int treeHeight(const FlatTree& tree)
+{
+    return static_cast<int>(tree.levelStart.size()) - 1;
+}
@@ -0,0 +1,229 @@
+#ifndef FLAT_COMBINING_H
+#define FLAT_COMBINING_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+#include "bst_parallel.h"
+
+/**
+* An AVLTree shared by many threads through flat combining. Each thread
+* posts its insert, remove or find into its own slot and waits. Whichever
+* waiting thread takes the combiner lock collects every posted request,
+* sorts the batch by key so neighbouring requests walk the same path and
+* hit the same cache lines, applies it, and marks each request done. The
+* tree is only ever touched by one thread at a time, and the lock is taken
+* once per batch instead of once per request.
+*
+* Threads beyond the slot count (maxThreads, 256 by default) fall back to
+* taking the combiner lock for their own request. Key and Value must be
+* default constructible. Exceptions thrown by the tree are rethrown in the
+* thread that posted the request.
+*/
+template <typename Key, typename Value>
+class FlatCombiningTree
+{
+public:
+    explicit FlatCombiningTree(unsigned maxThreads = 256);
+
+    void insert(const std::pair<const Key, Value>& item);
+    void remove(const Key& key);
+    bool find(const Key& key, Value& value);
+    template<typename F>
+    void read(F f);
+
+private:
+    enum Operation { OP_INSERT, OP_REMOVE, OP_FIND };
+    enum SlotState { SLOT_IDLE, SLOT_PENDING, SLOT_DONE };
+
+    /**
+    * One thread's request. Padded so slots of different threads do not
+    * share a cache line.
+    */
+    struct Slot
+    {
+        std::atomic<int> state;
+        Operation op;
+        Key key;
+        Value value;
+        bool found;
+        std::exception_ptr error;
+        char padding[64];
+
+        Slot() : state(SLOT_IDLE), op(OP_FIND), key(), value(), found(false) {}
+    };
+
+    FlatCombiningTree(const FlatCombiningTree&);
+    FlatCombiningTree& operator=(const FlatCombiningTree&);
+
+    bool post(Operation op, const Key& key, const Value& value, Value* result);
+    void combine();
+    void apply(Slot& slot);
+    static bool keyLess(const Slot* a, const Slot* b) { return a->key < b->key; }
+
+    AVLTree<Key, Value> tree_;
+    std::mutex combiner_;
+    std::vector<Slot> slots_;
+    // One more than the highest slot index in use, so combiners only scan that far
+    std::atomic<unsigned> usedSlots_;
+    // Scratch space for the combiner, reused between batches
+    std::vector<Slot*> batch_;
+};
+
+template<typename Key, typename Value>
+FlatCombiningTree<Key, Value>::FlatCombiningTree(unsigned maxThreads) :
+    tree_(), slots_(maxThreads), usedSlots_(0)
+{
+    batch_.reserve(maxThreads);
+}
+
+template<typename Key, typename Value>
+void FlatCombiningTree<Key, Value>::insert(const std::pair<const Key, Value>& item)
+{
+    post(OP_INSERT, item.first, item.second, nullptr);
+}
+
+template<typename Key, typename Value>
+void FlatCombiningTree<Key, Value>::remove(const Key& key)
+{
+    post(OP_REMOVE, key, Value(), nullptr);
+}
+
+/**
+* Copies the value for key into value and returns true, or returns false
+* if key is not present.
+*/
+template<typename Key, typename Value>
+bool FlatCombiningTree<Key, Value>::find(const Key& key, Value& value)
+{
+    return post(OP_FIND, key, Value(), &value);
+}
+
+/**
+* Calls f(tree) with the underlying AVLTree while holding the combiner
+* lock, for reads that need a consistent view of the whole tree.
+*/
+template<typename Key, typename Value>
+template<typename F>
+void FlatCombiningTree<Key, Value>::read(F f)
+{
+    std::lock_guard<std::mutex> lock(combiner_);
+    f(static_cast<const AVLTree<Key, Value>&>(tree_));
+}
+
+/**
+* Posts a request and waits until some combiner, possibly this thread,
+* has applied it. Returns whether a find found its key.
+*/
+template<typename Key, typename Value>
+bool FlatCombiningTree<Key, Value>::post(Operation op, const Key& key, const Value& value, Value* result)
+{
+    unsigned id = ThreadIndex::current();
+    if(id >= slots_.size()) {
+        //no slot for this thread, so it applies its own request
+        std::lock_guard<std::mutex> lock(combiner_);
+        switch(op) {
+        case OP_INSERT:
+            tree_.insert(std::make_pair(key, value));
+            return false;
+        case OP_REMOVE:
+            tree_.remove(key);
+            return false;
+        default: {
+            typename AVLTree<Key, Value>::iterator it = tree_.find(key);
+            if(it == tree_.end()) {
+                return false;
+            }
+            *result = it->second;
+            return true;
+        }
+        }
+    }
+    unsigned used = usedSlots_.load(std::memory_order_relaxed);
+    while(used <= id && !usedSlots_.compare_exchange_weak(used, id + 1)) {
+    }
+
+    Slot& slot = slots_[id];
+    slot.op = op;
+    slot.key = key;
+    slot.value = value;
+    slot.error = std::exception_ptr();
+    slot.state.store(SLOT_PENDING, std::memory_order_release);
+    while(slot.state.load(std::memory_order_acquire) != SLOT_DONE) {
+        if(combiner_.try_lock()) {
+            //this pass picks up our own request along with everyone else's
+            combine();
+            combiner_.unlock();
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    slot.state.store(SLOT_IDLE, std::memory_order_relaxed);
+    if(slot.error) {
+        std::rethrow_exception(slot.error);
+    }
+    if(op == OP_FIND && slot.found) {
+        *result = slot.value;
+    }
+    return slot.found;
+}
+
+/**
+* Applies every pending request in key order. Requests from different
+* threads are concurrent, so any order between them is a valid one, and
+* each thread has at most one request pending.
+*/
+template<typename Key, typename Value>
+void FlatCombiningTree<Key, Value>::combine()
+{
+    batch_.clear();
+    unsigned used = usedSlots_.load(std::memory_order_acquire);
+    for(unsigned i = 0; i < used; ++i) {
+        if(slots_[i].state.load(std::memory_order_acquire) == SLOT_PENDING) {
+            batch_.push_back(&slots_[i]);
+        }
+    }
+    std::sort(batch_.begin(), batch_.end(), keyLess);
+    for(size_t i = 0; i < batch_.size(); ++i) {
+        apply(*batch_[i]);
+    }
+    //results are published only after the whole batch, so waiters are woken together
+    for(size_t i = 0; i < batch_.size(); ++i) {
+        batch_[i]->state.store(SLOT_DONE, std::memory_order_release);
+    }
+}
+
+template<typename Key, typename Value>
+void FlatCombiningTree<Key, Value>::apply(Slot& slot)
+{
+    slot.found = false;
+    try {
+        switch(slot.op) {
+        case OP_INSERT:
+            tree_.insert(std::make_pair(slot.key, slot.value));
+            break;
+        case OP_REMOVE:
+            tree_.remove(slot.key);
+            break;
+        case OP_FIND: {
+            typename AVLTree<Key, Value>::iterator it = tree_.find(slot.key);
+            if(it != tree_.end()) {
+                slot.value = it->second;
+                slot.found = true;
+            }
+            break;
+        }
+        }
+    }
+    catch(...) {
+        slot.error = std::current_exception();
+    }
+}
+
+#endif
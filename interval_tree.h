@@ -0,0 +1,163 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include "augmented_avlbst.h"
+
+/**
+* The closed interval [start, end], the key of an IntervalTree. Intervals
+* are ordered by start and then by end, so several may share a start.
+*/
+template <typename Point>
+struct Interval
+{
+    Point start;
+    Point end;
+
+    Interval() : start(), end() {}
+    Interval(const Point& s, const Point& e) : start(s), end(e) {}
+};
+
+template<typename Point>
+bool operator<(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return a.start < b.start || (!(b.start < a.start) && a.end < b.end);
+}
+
+template<typename Point>
+bool operator>(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return b < a;
+}
+
+template<typename Point>
+bool operator==(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return !(a < b) && !(b < a);
+}
+
+// Lets the trees print interval keys
+template<typename Point>
+std::ostream& operator<<(std::ostream& out, const Interval<Point>& interval)
+{
+    return out << "[" << interval.start << ", " << interval.end << "]";
+}
+
+/**
+* The summary an IntervalTree keeps: the largest end in each subtree.
+*/
+template <typename Point, typename Value>
+struct MaxEndMonoid
+{
+    typedef Point Summary;
+    static Summary identity() { return std::numeric_limits<Point>::lowest(); }
+    static Summary of(const Interval<Point>& key, const Value&) { return key.end; }
+    static Summary combine(const Summary& a, const Summary& b) { return a < b ? b : a; }
+};
+
+/**
+* Closed intervals [start, end] with a value each, keyed by Interval. It is
+* an AugmentedAVLTree whose summary is the largest end in each subtree.
+*
+* overlapping and stabbing skip every subtree whose largest end is before
+* the query and everything right of a start after it, so they only descend
+* into subtrees holding a match. A query costs O(log n) for the boundary
+* paths plus the paths down to its k matches, at most O(log n + k log(n/k)).
+*/
+template <typename Point, typename Value>
+class IntervalTree : protected AugmentedAVLTree<Interval<Point>, Value, MaxEndMonoid<Point, Value> >
+{
+public:
+    typedef Interval<Point> Key;
+    typedef AugmentedAVLTree<Key, Value, MaxEndMonoid<Point, Value> > Base;
+    typedef typename Base::iterator iterator;
+
+    IntervalTree();
+
+    void insert(const Point& start, const Point& end, const Value& value);
+    void remove(const Point& start, const Point& end);
+    template<typename F>
+    void overlapping(const Point& lo, const Point& hi, F f) const;
+    template<typename F>
+    void stabbing(const Point& point, F f) const;
+
+    using Base::begin;
+    using Base::end;
+    using Base::find;
+    using Base::empty;
+    using Base::clear;
+
+protected:
+    typedef typename Base::ANode INode;
+
+    template<typename F>
+    static void overlapping(const INode* node, const Point& lo, const Point& hi, F& f);
+};
+
+template<typename Point, typename Value>
+IntervalTree<Point, Value>::IntervalTree() : Base()
+{
+}
+
+/**
+* Adds [start, end] with value, or replaces the value if that exact
+* interval is already present. Throws std::invalid_argument if end < start.
+*/
+template<typename Point, typename Value>
+void IntervalTree<Point, Value>::insert(const Point& start, const Point& end, const Value& value)
+{
+    if(end < start) {
+        throw std::invalid_argument("interval ends before it starts");
+    }
+    Base::insert(std::make_pair(Key(start, end), value));
+}
+
+template<typename Point, typename Value>
+void IntervalTree<Point, Value>::remove(const Point& start, const Point& end)
+{
+    Base::remove(Key(start, end));
+}
+
+/**
+* Calls f(item) for every interval that shares at least one point with
+* [lo, hi], in order of start.
+*/
+template<typename Point, typename Value>
+template<typename F>
+void IntervalTree<Point, Value>::overlapping(const Point& lo, const Point& hi, F f) const
+{
+    overlapping(this->root(), lo, hi, f);
+}
+
+/**
+* Calls f(item) for every interval that contains point, in order of start.
+*/
+template<typename Point, typename Value>
+template<typename F>
+void IntervalTree<Point, Value>::stabbing(const Point& point, F f) const
+{
+    overlapping(this->root(), point, point, f);
+}
+
+template<typename Point, typename Value>
+template<typename F>
+void IntervalTree<Point, Value>::overlapping(const INode* node, const Point& lo, const Point& hi, F& f)
+{
+    //the recursion only goes left, so its depth is bounded by the tree height
+    while(node != nullptr && !(node->getSummary() < lo)) {
+        overlapping(node->getLeft(), lo, hi, f);
+        //this node and everything right of it start after the query
+        if(hi < node->getKey().start) {
+            return;
+        }
+        if(!(node->getKey().end < lo)) {
+            f(node->getItem());
+        }
+        node = node->getRight();
+    }
+}
+
+#endif
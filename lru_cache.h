@@ -0,0 +1,340 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <functional>
+#include <utility>
+#include "avlbst.h"
+
+template <typename Key, typename Value>
+class OrderedLRUCache;
+
+/**
+* An AVLNode that is also an entry in the cache's recency list, so the
+* list needs no allocation of its own.
+*/
+template <typename Key, typename Value>
+class LRUNode : public AVLNode<Key, Value>
+{
+public:
+    LRUNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+        AVLNode<Key, Value>(key, value, parent),
+        newer_(NULL), older_(NULL), bytes_(0)
+    {
+    }
+
+private:
+    friend class OrderedLRUCache<Key, Value>;
+
+    LRUNode<Key, Value>* newer_;
+    LRUNode<Key, Value>* older_;
+    size_t bytes_;      // what this entry counts against a byte capacity
+};
+
+/**
+* What the capacity of an OrderedLRUCache counts.
+*/
+enum CacheLimit
+{
+    CACHE_LIMIT_ENTRIES,
+    CACHE_LIMIT_BYTES
+};
+
+/**
+* An ordered map of bounded size that evicts its least recently used
+* entries. The entries live in an AVLTree whose nodes also form a doubly
+* linked recency list, most recent first.
+*
+* get and put refresh an entry and cost O(log n). Finding the coldest entry
+* is O(1), and removing it costs only the tree's rebalancing, since no
+* search is needed. peek, scan and iteration read entries in key order
+* without changing their recency.
+*
+* With a byte capacity each entry is charged sizer(key, value) bytes when it
+* is put, or the size of its node if no sizer is given. An entry larger
+* than the whole capacity is evicted right after it is put, leaving the
+* other entries in place.
+*/
+template <typename Key, typename Value>
+class OrderedLRUCache : protected AVLTree<Key, Value>
+{
+public:
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+    typedef std::function<size_t(const Key&, const Value&)> EntrySizer;
+
+    explicit OrderedLRUCache(size_t capacity, CacheLimit limit = CACHE_LIMIT_ENTRIES,
+                             const EntrySizer& sizer = EntrySizer());
+
+    void put(const Key& key, const Value& value);
+    Value* get(const Key& key);
+    const Value* peek(const Key& key) const;
+    bool erase(const Key& key);
+    bool evict();
+    const std::pair<const Key, Value>* coldest() const;
+    template<typename F>
+    void scan(const Key& lo, const Key& hi, F f) const;
+    void clear();
+
+    size_t size() const { return entries_; }
+    size_t bytes() const { return bytes_; }
+    size_t capacity() const { return capacity_; }
+    void setCapacity(size_t capacity);
+
+    using AVLTree<Key, Value>::begin;
+    using AVLTree<Key, Value>::end;
+    using AVLTree<Key, Value>::empty;
+
+protected:
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+
+private:
+    OrderedLRUCache(const OrderedLRUCache&);
+    OrderedLRUCache& operator=(const OrderedLRUCache&);
+
+    size_t entrySize(const Key& key, const Value& value) const;
+    size_t used() const { return limit_ == CACHE_LIMIT_BYTES ? bytes_ : entries_; }
+    void pushFront(LRUNode<Key, Value>* node);
+    void unlink(LRUNode<Key, Value>* node);
+    void removeEntry(LRUNode<Key, Value>* node);
+    void evictToCapacity();
+    LRUNode<Key, Value>* lookup(const Key& key) const;
+
+    size_t capacity_;
+    CacheLimit limit_;
+    EntrySizer sizer_;
+    LRUNode<Key, Value>* newest_;
+    LRUNode<Key, Value>* oldest_;
+    size_t entries_;
+    size_t bytes_;
+};
+
+template<typename Key, typename Value>
+OrderedLRUCache<Key, Value>::OrderedLRUCache(size_t capacity, CacheLimit limit, const EntrySizer& sizer) :
+    AVLTree<Key, Value>(), capacity_(capacity), limit_(limit), sizer_(sizer),
+    newest_(NULL), oldest_(NULL), entries_(0), bytes_(0)
+{
+}
+
+/**
+* Every node the tree creates joins the recency list as the newest entry.
+*/
+template<typename Key, typename Value>
+AVLNode<Key, Value>* OrderedLRUCache<Key, Value>::createNode(const Key& key, const Value& value,
+                                                             AVLNode<Key, Value>* parent)
+{
+    LRUNode<Key, Value>* node = this->allocateNode(key, value, static_cast<LRUNode<Key, Value>*>(parent));
+    node->bytes_ = entrySize(key, value);
+    bytes_ += node->bytes_;
+    ++entries_;
+    pushFront(node);
+    return node;
+}
+
+template<typename Key, typename Value>
+size_t OrderedLRUCache<Key, Value>::entrySize(const Key& key, const Value& value) const
+{
+    return sizer_ ? sizer_(key, value) : sizeof(LRUNode<Key, Value>);
+}
+
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::pushFront(LRUNode<Key, Value>* node)
+{
+    node->older_ = newest_;
+    node->newer_ = NULL;
+    if(newest_ != NULL) {
+        newest_->newer_ = node;
+    }
+    newest_ = node;
+    if(oldest_ == NULL) {
+        oldest_ = node;
+    }
+}
+
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::unlink(LRUNode<Key, Value>* node)
+{
+    if(node->newer_ != NULL) {
+        node->newer_->older_ = node->older_;
+    }
+    else {
+        newest_ = node->older_;
+    }
+    if(node->older_ != NULL) {
+        node->older_->newer_ = node->newer_;
+    }
+    else {
+        oldest_ = node->newer_;
+    }
+}
+
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::removeEntry(LRUNode<Key, Value>* node)
+{
+    unlink(node);
+    bytes_ -= node->bytes_;
+    --entries_;
+    this->removeNode(node);
+}
+
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::evictToCapacity()
+{
+    while(used() > capacity_ && oldest_ != NULL) {
+        removeEntry(oldest_);
+    }
+}
+
+template<typename Key, typename Value>
+LRUNode<Key, Value>* OrderedLRUCache<Key, Value>::lookup(const Key& key) const
+{
+    return static_cast<LRUNode<Key, Value>*>(this->internalFind(key));
+}
+
+/**
+* Inserts or overwrites key, makes it the most recent entry, and evicts the
+* coldest entries until the cache fits its capacity again.
+*/
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::put(const Key& key, const Value& value)
+{
+    size_t before = entries_;
+    LRUNode<Key, Value>* node = static_cast<LRUNode<Key, Value>*>(this->insertNode(std::make_pair(key, value)));
+    if(entries_ == before) {
+        //an existing entry was overwritten, so charge it for its new value
+        bytes_ -= node->bytes_;
+        node->bytes_ = entrySize(key, value);
+        bytes_ += node->bytes_;
+        unlink(node);
+        pushFront(node);
+    }
+    if(limit_ == CACHE_LIMIT_BYTES && node->bytes_ > capacity_) {
+        //evicting colder entries could never make room for this one
+        removeEntry(node);
+        return;
+    }
+    evictToCapacity();
+}
+
+/**
+* Returns the value for key and makes it the most recent entry, or NULL if
+* key is not cached.
+*/
+template<typename Key, typename Value>
+Value* OrderedLRUCache<Key, Value>::get(const Key& key)
+{
+    LRUNode<Key, Value>* node = lookup(key);
+    if(node == NULL) {
+        return NULL;
+    }
+    if(node != newest_) {
+        unlink(node);
+        pushFront(node);
+    }
+    return &node->getValue();
+}
+
+/**
+* Like get, but leaves the recency unchanged.
+*/
+template<typename Key, typename Value>
+const Value* OrderedLRUCache<Key, Value>::peek(const Key& key) const
+{
+    LRUNode<Key, Value>* node = lookup(key);
+    return node == NULL ? NULL : &node->getValue();
+}
+
+/**
+* Removes key. Returns false if it was not cached.
+*/
+template<typename Key, typename Value>
+bool OrderedLRUCache<Key, Value>::erase(const Key& key)
+{
+    LRUNode<Key, Value>* node = lookup(key);
+    if(node == NULL) {
+        return false;
+    }
+    removeEntry(node);
+    return true;
+}
+
+/**
+* Removes the least recently used entry. Returns false if the cache is empty.
+*/
+template<typename Key, typename Value>
+bool OrderedLRUCache<Key, Value>::evict()
+{
+    if(oldest_ == NULL) {
+        return false;
+    }
+    removeEntry(oldest_);
+    return true;
+}
+
+/**
+* The entry evict would remove next, or NULL if the cache is empty.
+*/
+template<typename Key, typename Value>
+const std::pair<const Key, Value>* OrderedLRUCache<Key, Value>::coldest() const
+{
+    return oldest_ == NULL ? NULL : &oldest_->getItem();
+}
+
+/**
+* Calls f(item) for every entry with lo <= key <= hi, in key order, without
+* changing recency. f must not modify the cache.
+*/
+template<typename Key, typename Value>
+template<typename F>
+void OrderedLRUCache<Key, Value>::scan(const Key& lo, const Key& hi, F f) const
+{
+    //find the first node not less than lo
+    const Node<Key, Value>* node = NULL;
+    for(const Node<Key, Value>* current = this->root_; current != NULL; ) {
+        if(current->getKey() < lo) {
+            current = current->getRight();
+        }
+        else {
+            node = current;
+            current = current->getLeft();
+        }
+    }
+    while(node != NULL && !(hi < node->getKey())) {
+        f(node->getItem());
+        //step to the in-order successor
+        if(node->getRight() != NULL) {
+            node = node->getRight();
+            while(node->getLeft() != NULL) {
+                node = node->getLeft();
+            }
+        }
+        else {
+            const Node<Key, Value>* child = node;
+            node = node->getParent();
+            while(node != NULL && node->getRight() == child) {
+                child = node;
+                node = node->getParent();
+            }
+        }
+    }
+}
+
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::clear()
+{
+    AVLTree<Key, Value>::clear();
+    newest_ = NULL;
+    oldest_ = NULL;
+    entries_ = 0;
+    bytes_ = 0;
+}
+
+/**
+* Changes the capacity, evicting the coldest entries if the cache no longer fits.
+*/
+template<typename Key, typename Value>
+void OrderedLRUCache<Key, Value>::setCapacity(size_t capacity)
+{
+    capacity_ = capacity;
+    evictToCapacity();
+}
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef MAPPED_BST_H
+#define MAPPED_BST_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bst.h"
+
+/**
+* A frozen tree image is a single file that can be mmap'ed and searched in
+* place. It holds a MappedTreeHeader padded to dataOffset, followed by count
+* MappedRecords stored in key order. Records link to their children by record
+* index instead of by pointer, so the image is valid at any address and can be
+* shared read-only by every process that maps it. The links keep the shape of
+* the tree the image was written from; the key order of the array makes
+* in-order iteration and range scans a sequential walk.
+*/
+struct MappedTreeHeader
+{
+    char magic[4];          // "BSTM"
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint32_t recordSize;
+    uint32_t root;          // index of the root record, MAPPED_NIL if empty
+    uint64_t count;
+    uint64_t dataOffset;    // byte offset of the first record
+};
+
+static const char MAPPED_TREE_MAGIC[4] = {'B', 'S', 'T', 'M'};
+static const uint32_t MAPPED_TREE_VERSION = 1;
+static const uint32_t MAPPED_NIL = 0xFFFFFFFFu;
+// Records start on their own cache line
+static const uint64_t MAPPED_DATA_OFFSET = 64;
+
+template <typename Key, typename Value>
+struct MappedRecord
+{
+    Key key;
+    Value value;
+    uint32_t left;
+    uint32_t right;
+};
+
+/**
+* Copies the subtree at node into records in key order, starting at index next.
+* Returns the index of the subtree's root, or MAPPED_NIL for an empty subtree.
+*/
+template<typename Key, typename Value>
+uint32_t fillMappedRecords(const Node<Key, Value>* node, MappedRecord<Key, Value>* records, uint32_t& next)
+{
+    if(node == nullptr) {
+        return MAPPED_NIL;
+    }
+    uint32_t left = fillMappedRecords(node->getLeft(), records, next);
+    uint32_t self = next++;
+    MappedRecord<Key, Value>& record = records[self];
+    std::memcpy(&record.key, &node->getKey(), sizeof(Key));
+    std::memcpy(&record.value, &node->getValue(), sizeof(Value));
+    record.left = left;
+    record.right = fillMappedRecords(node->getRight(), records, next);
+    return self;
+}
+
+/**
+* Writes tree as a frozen image at path. The image is built in a temporary
+* file and renamed into place, so processes that still map an older image at
+* the same path keep a valid view. Throws std::runtime_error on I/O failure.
+*/
+template<typename Key, typename Value>
+void writeMappedTree(const BinarySearchTree<Key, Value>& tree, const char* path)
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "mapped trees require trivially copyable Key and Value");
+    typedef MappedRecord<Key, Value> Record;
+
+    uint64_t count = 0;
+    for(typename BinarySearchTree<Key, Value>::iterator it = tree.begin(); it != tree.end(); ++it) {
+        ++count;
+    }
+    if(count >= MAPPED_NIL) {
+        throw std::runtime_error("Tree is too large for a mapped image");
+    }
+
+    std::string tmpPath = std::string(path) + ".tmp";
+    int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        throw std::runtime_error("Cannot create " + tmpPath);
+    }
+    size_t fileSize = MAPPED_DATA_OFFSET + count * sizeof(Record);
+    void* base = MAP_FAILED;
+    if(ftruncate(fd, fileSize) == 0) {
+        base = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if(base == MAP_FAILED) {
+        close(fd);
+        unlink(tmpPath.c_str());
+        throw std::runtime_error("Cannot size or map " + tmpPath);
+    }
+
+    // the file is zero filled by ftruncate, so record padding is deterministic
+    MappedTreeHeader* header = static_cast<MappedTreeHeader*>(base);
+    std::memcpy(header->magic, MAPPED_TREE_MAGIC, sizeof(header->magic));
+    header->version = MAPPED_TREE_VERSION;
+    header->keySize = sizeof(Key);
+    header->valueSize = sizeof(Value);
+    header->recordSize = sizeof(Record);
+    header->count = count;
+    header->dataOffset = MAPPED_DATA_OFFSET;
+    uint32_t next = 0;
+    header->root = fillMappedRecords(tree.root_, reinterpret_cast<Record*>(static_cast<char*>(base) + MAPPED_DATA_OFFSET), next);
+
+    bool ok = msync(base, fileSize, MS_SYNC) == 0;
+    munmap(base, fileSize);
+    ok = (close(fd) == 0) && ok;
+    if(!ok or rename(tmpPath.c_str(), path) != 0) {
+        unlink(tmpPath.c_str());
+        throw std::runtime_error(std::string("Cannot write mapped tree ") + path);
+    }
+}
+
+/**
+* A read-only view of a frozen tree image. Opening maps the file and checks
+* its header, which is O(1): pages are brought in by the page cache as they
+* are touched and are shared between all processes mapping the same file.
+*/
+template <typename Key, typename Value>
+class MappedTreeView
+{
+public:
+    typedef MappedRecord<Key, Value> Record;
+
+    explicit MappedTreeView(const char* path);
+    ~MappedTreeView();
+
+    /**
+    * Iterates over records in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator() : current_(NULL) {}
+
+        const Record& operator*() const { return *current_; }
+        const Record* operator->() const { return current_; }
+
+        bool operator==(const iterator& rhs) const { return current_ == rhs.current_; }
+        bool operator!=(const iterator& rhs) const { return current_ != rhs.current_; }
+
+        iterator& operator++() { ++current_; return *this; }
+
+    protected:
+        friend class MappedTreeView<Key, Value>;
+        explicit iterator(const Record* ptr) : current_(ptr) {}
+        const Record* current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lowerBound(const Key& key) const;
+    iterator upperBound(const Key& key) const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    MappedTreeView(const MappedTreeView&);
+    MappedTreeView& operator=(const MappedTreeView&);
+
+    uint32_t follow(uint32_t link, uint64_t lo, uint64_t hi) const;
+
+    void* base_;
+    size_t length_;
+    const Record* records_;
+    uint32_t root_;
+    size_t count_;
+};
+
+/**
+* Maps the image at path. Throws std::runtime_error if the file cannot be
+* mapped, was written for a different Key/Value layout, or its header does
+* not match its length. Child links are checked as searches follow them.
+*/
+template<typename Key, typename Value>
+MappedTreeView<Key, Value>::MappedTreeView(const char* path) :
+    base_(MAP_FAILED), length_(0), records_(NULL), root_(MAPPED_NIL), count_(0)
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "mapped trees require trivially copyable Key and Value");
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error(std::string("Cannot open ") + path);
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(MappedTreeHeader)) {
+        length_ = st.st_size;
+        base_ = mmap(NULL, length_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if(base_ == MAP_FAILED) {
+        throw std::runtime_error(std::string("Cannot map ") + path);
+    }
+
+    const MappedTreeHeader* header = static_cast<const MappedTreeHeader*>(base_);
+    const char* error = NULL;
+    if(std::memcmp(header->magic, MAPPED_TREE_MAGIC, sizeof(header->magic)) != 0) {
+        error = "Not a mapped tree image";
+    }
+    else if(header->version != MAPPED_TREE_VERSION) {
+        error = "Unsupported mapped tree version";
+    }
+    else if(header->keySize != sizeof(Key) || header->valueSize != sizeof(Value) ||
+            header->recordSize != sizeof(Record)) {
+        error = "Mapped tree record layout does not match this view";
+    }
+    // compared by division so a huge count in a corrupt header cannot wrap around
+    else if(header->dataOffset < sizeof(MappedTreeHeader) || header->dataOffset > length_ ||
+            header->dataOffset % alignof(Record) != 0 ||
+            (length_ - header->dataOffset) % sizeof(Record) != 0 ||
+            (length_ - header->dataOffset) / sizeof(Record) != header->count) {
+        error = "Mapped tree image is truncated or corrupt";
+    }
+    else if(header->count == 0 ? header->root != MAPPED_NIL : header->root >= header->count) {
+        error = "Mapped tree image has a bad root";
+    }
+    if(error != NULL) {
+        munmap(base_, length_);
+        throw std::runtime_error(error);
+    }
+
+    records_ = reinterpret_cast<const Record*>(static_cast<const char*>(base_) + header->dataOffset);
+    root_ = header->root;
+    count_ = header->count;
+}
+
+template<typename Key, typename Value>
+MappedTreeView<Key, Value>::~MappedTreeView()
+{
+    munmap(base_, length_);
+}
+
+template<typename Key, typename Value>
+typename MappedTreeView<Key, Value>::iterator MappedTreeView<Key, Value>::begin() const
+{
+    return iterator(records_);
+}
+
+template<typename Key, typename Value>
+typename MappedTreeView<Key, Value>::iterator MappedTreeView<Key, Value>::end() const
+{
+    return iterator(records_ + count_);
+}
+
+/**
+* Returns an iterator to the record with the given key, or end() if none.
+*/
+template<typename Key, typename Value>
+typename MappedTreeView<Key, Value>::iterator MappedTreeView<Key, Value>::find(const Key& key) const
+{
+    uint32_t current = root_;
+    uint64_t lo = 0, hi = count_;
+    while(current != MAPPED_NIL) {
+        const Record& record = records_[current];
+        if(key < record.key) {
+            hi = current;
+            current = follow(record.left, lo, hi);
+        }
+        else if(record.key < key) {
+            lo = current + 1;
+            current = follow(record.right, lo, hi);
+        }
+        else {
+            return iterator(&record);
+        }
+    }
+    return end();
+}
+
+/**
+* Returns an iterator to the first record whose key is not less than key.
+* Together with upperBound this gives range scans: a search down the links
+* followed by a sequential walk of the record array.
+*/
+template<typename Key, typename Value>
+typename MappedTreeView<Key, Value>::iterator MappedTreeView<Key, Value>::lowerBound(const Key& key) const
+{
+    uint32_t current = root_;
+    uint32_t best = static_cast<uint32_t>(count_);
+    uint64_t lo = 0, hi = count_;
+    while(current != MAPPED_NIL) {
+        if(records_[current].key < key) {
+            lo = current + 1;
+            current = follow(records_[current].right, lo, hi);
+        }
+        else {
+            best = current;
+            hi = current;
+            current = follow(records_[current].left, lo, hi);
+        }
+    }
+    return iterator(records_ + best);
+}
+
+/**
+* Returns an iterator to the first record whose key is greater than key.
+*/
+template<typename Key, typename Value>
+typename MappedTreeView<Key, Value>::iterator MappedTreeView<Key, Value>::upperBound(const Key& key) const
+{
+    uint32_t current = root_;
+    uint32_t best = static_cast<uint32_t>(count_);
+    uint64_t lo = 0, hi = count_;
+    while(current != MAPPED_NIL) {
+        if(key < records_[current].key) {
+            best = current;
+            hi = current;
+            current = follow(records_[current].left, lo, hi);
+        }
+        else {
+            lo = current + 1;
+            current = follow(records_[current].right, lo, hi);
+        }
+    }
+    return iterator(records_ + best);
+}
+
+/**
+* Returns link after checking it during a descent that has narrowed to the
+* records [lo, hi). Records are stored in key order, so every subtree of a
+* valid image covers a contiguous run of indices and each step down shrinks
+* the run. A link outside it means the image is corrupt, and refusing it
+* also keeps a cycle of links from looping forever. Throws
+* std::runtime_error for such a link.
+*/
+template<typename Key, typename Value>
+uint32_t MappedTreeView<Key, Value>::follow(uint32_t link, uint64_t lo, uint64_t hi) const
+{
+    if(link != MAPPED_NIL && (link < lo || link >= hi)) {
+        throw std::runtime_error("Mapped tree image has a bad child link");
+    }
+    return link;
+}
+
+template<typename Key, typename Value>
+size_t MappedTreeView<Key, Value>::size() const
+{
+    return count_;
+}
+
+template<typename Key, typename Value>
+bool MappedTreeView<Key, Value>::empty() const
+{
+    return count_ == 0;
+}
+
+#endif
@@ -0,0 +1,504 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+enum RBColor
+{
+    RB_RED,
+    RB_BLACK
+};
+
+/**
+* A node of a RedBlackTree, which adds a color to the plain Node.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+
+    RBColor getColor() const;
+    void setColor(RBColor color);
+
+    // Redefined to return RBNodes, as in AVLNode
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    RBColor color_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* New nodes are red, as insert expects.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent) :
+    Node<Key, Value>(key, value, parent), color_(RB_RED)
+{
+
+}
+
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+template<class Key, class Value>
+RBColor RBNode<Key, Value>::getColor() const
+{
+    return color_;
+}
+
+template<class Key, class Value>
+void RBNode<Key, Value>::setColor(RBColor color)
+{
+    color_ = color;
+}
+
+template<class Key, class Value>
+RBNode<Key, Value>* RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+RBNode<Key, Value>* RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+RBNode<Key, Value>* RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A red-black tree. Every path from a node down to a missing child passes
+* the same number of black nodes, and a red node never has a red child, so
+* the height stays within 2 log2(n + 1).
+*
+* Compared with AVLTree the shape is looser, so lookups may go a level or
+* two deeper, but rebalancing is cheaper: insert does at most two rotations
+* and remove at most three, where an AVL remove can rotate at every level.
+* Recoloring still walks up to O(log n) levels, but it only writes colors.
+*/
+template <class Key, class Value>
+class RedBlackTree : public BinarySearchTree<Key, Value>
+{
+public:
+    RedBlackTree();
+    RedBlackTree(const RedBlackTree<Key, Value>& other);
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    virtual bool isBalanced() const;
+    virtual int height() const;
+protected:
+    virtual void nodeSwap(RBNode<Key, Value>* n1, RBNode<Key, Value>* n2);
+    virtual Node<Key, Value>* cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const;
+
+    void insertFix(RBNode<Key, Value>* node);
+    void removeFix(RBNode<Key, Value>* node, RBNode<Key, Value>* parent);
+    void rotateRight(RBNode<Key, Value>* node);
+    void rotateLeft(RBNode<Key, Value>* node);
+    static bool isRed(const RBNode<Key, Value>* node);
+    static int checkedBlackHeight(const RBNode<Key, Value>* node);
+};
+
+template<class Key, class Value>
+RedBlackTree<Key, Value>::RedBlackTree() : BinarySearchTree<Key, Value>()
+{
+
+}
+
+/**
+* Copy constructor. As with AVLTree, the copy is made here so cloneTree
+* dispatches to the RBNode version.
+*/
+template<class Key, class Value>
+RedBlackTree<Key, Value>::RedBlackTree(const RedBlackTree<Key, Value>& other) : BinarySearchTree<Key, Value>()
+{
+    this->copyFrom(other);
+}
+
+/**
+* Checks the red-black invariants in O(n): the root is black, no red node
+* has a red child, and every path down to a missing child passes the same
+* number of black nodes. These bound the height, but not the per-node
+* height difference that verifyBalanced looks for, so a valid red-black
+* tree can fail verifyBalanced.
+*/
+template<class Key, class Value>
+bool RedBlackTree<Key, Value>::isBalanced() const
+{
+    const RBNode<Key, Value>* root = static_cast<const RBNode<Key, Value>*>(this->root_);
+    if(isRed(root)) {
+        return false;
+    }
+    return checkedBlackHeight(root) != -1;
+}
+
+/**
+* The number of black nodes on every path down from node, or -1 as soon as
+* two paths disagree or a red node is found with a red child.
+*/
+template<class Key, class Value>
+int RedBlackTree<Key, Value>::checkedBlackHeight(const RBNode<Key, Value>* node)
+{
+    if(node == nullptr) {
+        return 0;
+    }
+    if(isRed(node) && (isRed(node->getLeft()) || isRed(node->getRight()))) {
+        return -1;
+    }
+    int left = checkedBlackHeight(node->getLeft());
+    if(left == -1) {
+        return -1;
+    }
+    int right = checkedBlackHeight(node->getRight());
+    if(right != left) {
+        return -1;
+    }
+    return left + (isRed(node) ? 0 : 1);
+}
+
+/**
+* Returns the height of the tree in O(n) with an in-order walk over the
+* parent pointers. Red-black trees do not keep enough information to do
+* better.
+*/
+template<class Key, class Value>
+int RedBlackTree<Key, Value>::height() const
+{
+    const Node<Key, Value>* node = this->root_;
+    if(node == nullptr) {
+        return 0;
+    }
+    int depth = 0;
+    int height = 0;
+    while(node->getLeft() != nullptr) {
+        node = node->getLeft();
+        ++depth;
+    }
+    while(node != nullptr) {
+        height = std::max(height, depth + 1);
+        if(node->getRight() != nullptr) {
+            node = node->getRight();
+            ++depth;
+            while(node->getLeft() != nullptr) {
+                node = node->getLeft();
+                ++depth;
+            }
+        }
+        else {
+            const Node<Key, Value>* child = node;
+            node = node->getParent();
+            --depth;
+            while(node != nullptr && node->getRight() == child) {
+                child = node;
+                node = node->getParent();
+                --depth;
+            }
+        }
+    }
+    return height;
+}
+
+/**
+* Clones the subtree at src as RBNodes, keeping each node's color.
+*/
+template<class Key, class Value>
+Node<Key, Value>* RedBlackTree<Key, Value>::cloneTree(const Node<Key, Value>* src, Node<Key, Value>* parent) const
+{
+    if(src == nullptr) {
+        return nullptr;
+    }
+    const RBNode<Key, Value>* rbSrc = static_cast<const RBNode<Key, Value>*>(src);
+    RBNode<Key, Value>* copy = this->allocateNode(rbSrc->getKey(), rbSrc->getValue(), static_cast<RBNode<Key, Value>*>(parent));
+    copy->setColor(rbSrc->getColor());
+    copy->setLeft(cloneTree(rbSrc->getLeft(), copy));
+    copy->setRight(cloneTree(rbSrc->getRight(), copy));
+    return copy;
+}
+
+// Missing children count as black
+template<class Key, class Value>
+bool RedBlackTree<Key, Value>::isRed(const RBNode<Key, Value>* node)
+{
+    return node != nullptr && node->getColor() == RB_RED;
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::rotateRight(RBNode<Key, Value>* node)
+{
+    BST_STAT_ADD(rotateRights, 1);
+    RBNode<Key, Value>* child = node->getLeft();
+    RBNode<Key, Value>* changeNode = child->getRight();
+    RBNode<Key, Value>* parent = node->getParent();
+
+    child->setParent(parent);
+    node->setParent(child);
+    node->setLeft(changeNode);
+    if(changeNode != nullptr) {
+        changeNode->setParent(node);
+    }
+    child->setRight(node);
+
+    if(parent == nullptr) {
+        this->root_ = child;
+    }
+    else if(parent->getLeft() == node) {
+        parent->setLeft(child);
+    }
+    else {
+        parent->setRight(child);
+    }
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::rotateLeft(RBNode<Key, Value>* node)
+{
+    BST_STAT_ADD(rotateLefts, 1);
+    RBNode<Key, Value>* child = node->getRight();
+    RBNode<Key, Value>* changeNode = child->getLeft();
+    RBNode<Key, Value>* parent = node->getParent();
+
+    child->setParent(parent);
+    node->setParent(child);
+    node->setRight(changeNode);
+    if(changeNode != nullptr) {
+        changeNode->setParent(node);
+    }
+    child->setLeft(node);
+
+    if(parent == nullptr) {
+        this->root_ = child;
+    }
+    else if(parent->getLeft() == node) {
+        parent->setLeft(child);
+    }
+    else {
+        parent->setRight(child);
+    }
+}
+
+/**
+* Restores the red-black properties after node was inserted red. A red
+* uncle is fixed by recoloring and moving two levels up; a black uncle
+* ends the fix with one or two rotations.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::insertFix(RBNode<Key, Value>* node)
+{
+    while(isRed(node->getParent())) {
+        BST_STAT_ADD(insertFixSteps, 1);
+        RBNode<Key, Value>* parent = node->getParent();
+        //the parent is red, so it is not the root and the grandparent exists
+        RBNode<Key, Value>* grandparent = parent->getParent();
+        bool parentIsLeft = grandparent->getLeft() == parent;
+        RBNode<Key, Value>* uncle = parentIsLeft ? grandparent->getRight() : grandparent->getLeft();
+        if(isRed(uncle)) {
+            parent->setColor(RB_BLACK);
+            uncle->setColor(RB_BLACK);
+            grandparent->setColor(RB_RED);
+            node = grandparent;
+            continue;
+        }
+        //zig zag: rotate the node above its parent to make it a zig zig
+        if(parentIsLeft && parent->getRight() == node) {
+            rotateLeft(parent);
+            parent = node;
+        }
+        else if(!parentIsLeft && parent->getLeft() == node) {
+            rotateRight(parent);
+            parent = node;
+        }
+        parent->setColor(RB_BLACK);
+        grandparent->setColor(RB_RED);
+        if(parentIsLeft) {
+            rotateRight(grandparent);
+        }
+        else {
+            rotateLeft(grandparent);
+        }
+        break;
+    }
+    static_cast<RBNode<Key, Value>*>(this->root_)->setColor(RB_BLACK);
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
+    //walk down to the insertion point, overwriting the value if the key is already present
+    RBNode<Key, Value>* current = static_cast<RBNode<Key, Value>*>(this->root_);
+    RBNode<Key, Value>* parent = nullptr;
+    bool goLeft = false;
+    while(current != nullptr) {
+        parent = current;
+        BST_STAT_ADD(comparisons, 1);
+        if(new_item.first < current->getKey()) {
+            goLeft = true;
+            current = current->getLeft();
+        }
+        else if(BST_STAT_ADD(comparisons, 1), new_item.first > current->getKey()) {
+            goLeft = false;
+            current = current->getRight();
+        }
+        else {
+            current->setValue(new_item.second);
+            return;
+        }
+    }
+
+    RBNode<Key, Value>* insertedNode = this->allocateNode(new_item.first, new_item.second, parent);
+    if(parent == nullptr) {
+        this->root_ = insertedNode;
+    }
+    else if(goLeft) {
+        parent->setLeft(insertedNode);
+    }
+    else {
+        parent->setRight(insertedNode);
+    }
+    insertFix(insertedNode);
+}
+
+/**
+* Called after a black node was removed from under parent, leaving node
+* (possibly NULL) one black short. Each step either recolors and moves up
+* a level without rotating, or finishes within three rotations in total.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::removeFix(RBNode<Key, Value>* node, RBNode<Key, Value>* parent)
+{
+    while(parent != nullptr && !isRed(node)) {
+        BST_STAT_ADD(removeFixSteps, 1);
+        bool nodeIsLeft = parent->getLeft() == node;
+        //the sibling's side has at least one more black node, so it exists
+        RBNode<Key, Value>* sibling = nodeIsLeft ? parent->getRight() : parent->getLeft();
+        if(isRed(sibling)) {
+            //make the sibling black so one of the cases below applies
+            sibling->setColor(RB_BLACK);
+            parent->setColor(RB_RED);
+            if(nodeIsLeft) {
+                rotateLeft(parent);
+                sibling = parent->getRight();
+            }
+            else {
+                rotateRight(parent);
+                sibling = parent->getLeft();
+            }
+        }
+        RBNode<Key, Value>* nearNephew = nodeIsLeft ? sibling->getLeft() : sibling->getRight();
+        RBNode<Key, Value>* farNephew = nodeIsLeft ? sibling->getRight() : sibling->getLeft();
+        if(!isRed(nearNephew) && !isRed(farNephew)) {
+            //take a black from both sides and push the shortage up
+            sibling->setColor(RB_RED);
+            node = parent;
+            parent = node->getParent();
+            continue;
+        }
+        if(!isRed(farNephew)) {
+            //turn the near nephew into the far one
+            nearNephew->setColor(RB_BLACK);
+            sibling->setColor(RB_RED);
+            if(nodeIsLeft) {
+                rotateRight(sibling);
+            }
+            else {
+                rotateLeft(sibling);
+            }
+            farNephew = sibling;
+            sibling = nearNephew;
+        }
+        sibling->setColor(parent->getColor());
+        parent->setColor(RB_BLACK);
+        farNephew->setColor(RB_BLACK);
+        if(nodeIsLeft) {
+            rotateLeft(parent);
+        }
+        else {
+            rotateRight(parent);
+        }
+        return;
+    }
+    if(node != nullptr) {
+        node->setColor(RB_BLACK);
+    }
+}
+
+/*
+ * As in the other trees, a node with two children is swapped with its
+ * predecessor before it is removed.
+ */
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::remove(const Key& key)
+{
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
+    RBNode<Key, Value>* removeNode = static_cast<RBNode<Key, Value>*>(this->internalFind(key));
+    if(removeNode == nullptr) {
+        return;
+    }
+    if(removeNode->getLeft() != nullptr && removeNode->getRight() != nullptr) {
+        nodeSwap(removeNode, static_cast<RBNode<Key, Value>*>(this->predecessor(removeNode)));
+    }
+
+    //removeNode now has at most one child, which takes its place
+    RBNode<Key, Value>* parent = removeNode->getParent();
+    RBNode<Key, Value>* child = removeNode->getLeft() != nullptr ? removeNode->getLeft() : removeNode->getRight();
+    if(child != nullptr) {
+        child->setParent(parent);
+    }
+    if(parent == nullptr) {
+        this->root_ = child;
+    }
+    else if(parent->getLeft() == removeNode) {
+        parent->setLeft(child);
+    }
+    else {
+        parent->setRight(child);
+    }
+
+    //removing a red node changes no black counts
+    if(removeNode->getColor() == RB_BLACK) {
+        removeFix(child, parent);
+    }
+    this->freeNode(removeNode);
+    this->noteRemoval();
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::nodeSwap(RBNode<Key, Value>* n1, RBNode<Key, Value>* n2)
+{
+    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    //colors belong to positions in the tree, so they trade places too
+    RBColor color = n1->getColor();
+    n1->setColor(n2->getColor());
+    n2->setColor(color);
+}
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <stdexcept>
+#include "bst.h"
+
+/**
+* A self-adjusting binary search tree. find, operator[] and insert move the
+* node they reach to the root with splay rotations, so keys that are used
+* often stay near the top. A find that misses splays the last node it
+* visited, so repeated misses down a long path do not cost O(n) each.
+* Sequences of operations run in amortized O(log n) time, but a single
+* operation can take O(n).
+*
+* Splaying rewrites the path to the root, so with a splay period of k only
+* every k-th access splays and the rest are plain lookups. Larger periods
+* save writes at the price of adapting more slowly.
+*
+* find through a const SplayTree (or a BinarySearchTree reference) does not
+* splay. remove is the unbalanced BinarySearchTree remove. Heights and the
+* imbalance count are kept up to date through rotations, so isBalanced and
+* height still run in O(1). Iterating while splaying may visit nodes out of
+* order, since splaying changes the shape the iterator follows.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+    using BinarySearchTree<Key, Value>::find;
+    using BinarySearchTree<Key, Value>::operator[];
+
+    explicit SplayTree(unsigned splayPeriod = 1);
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    iterator find(const Key& key);
+    Value& operator[](const Key& key);
+    void setSplayPeriod(unsigned splayPeriod);
+
+protected:
+    bool shouldSplay();
+    Node<Key, Value>* search(const Key& key, Node<Key, Value>*& last) const;
+    void splay(Node<Key, Value>* node);
+    void rotateUp(Node<Key, Value>* node);
+    void updateHeight(Node<Key, Value>* node);
+
+    unsigned splayPeriod_;
+    unsigned accesses_;
+};
+
+template<class Key, class Value>
+SplayTree<Key, Value>::SplayTree(unsigned splayPeriod) :
+    BinarySearchTree<Key, Value>(), splayPeriod_(splayPeriod == 0 ? 1 : splayPeriod), accesses_(0)
+{
+
+}
+
+/**
+* Splays on every splayPeriod-th access (1, the default, splays on every access).
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::setSplayPeriod(unsigned splayPeriod)
+{
+    splayPeriod_ = splayPeriod == 0 ? 1 : splayPeriod;
+    accesses_ = 0;
+}
+
+template<class Key, class Value>
+bool SplayTree<Key, Value>::shouldSplay()
+{
+    if(++accesses_ < splayPeriod_) {
+        return false;
+    }
+    accesses_ = 0;
+    return true;
+}
+
+/**
+* Inserts or overwrites like BinarySearchTree::insert, then splays the node.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
+    Node<Key, Value>* current = this->root_;
+    Node<Key, Value>* parent = nullptr;
+    bool goLeft = false;
+    while(current != nullptr) {
+        parent = current;
+        BST_STAT_ADD(comparisons, 1);
+        if(keyValuePair.first < current->getKey()) {
+            goLeft = true;
+            current = current->getLeft();
+        }
+        else if(BST_STAT_ADD(comparisons, 1), current->getKey() < keyValuePair.first) {
+            goLeft = false;
+            current = current->getRight();
+        }
+        else {
+            current->setValue(keyValuePair.second);
+            break;
+        }
+    }
+    if(current == nullptr) {
+        current = this->allocateNode(keyValuePair.first, keyValuePair.second, parent);
+        if(parent == nullptr) {
+            this->root_ = current;
+        }
+        else if(goLeft) {
+            parent->setLeft(current);
+        }
+        else {
+            parent->setRight(current);
+        }
+        this->fixHeightsUpward(current, parent, 0);
+    }
+    if(shouldSplay()) {
+        splay(current);
+    }
+}
+
+/**
+* Returns an iterator to key, or end if it is missing, splaying the node
+* found, or on a miss the last node visited.
+*/
+template<class Key, class Value>
+typename SplayTree<Key, Value>::iterator SplayTree<Key, Value>::find(const Key& key)
+{
+    if(!shouldSplay()) {
+        return BinarySearchTree<Key, Value>::find(key);
+    }
+    this->unshare();
+    Node<Key, Value>* last = nullptr;
+    Node<Key, Value>* node = search(key, last);
+    if(node == nullptr) {
+        if(last != nullptr) {
+            splay(last);
+        }
+        return this->end();
+    }
+    splay(node);
+    // the node is now the root, so this lookup is a single comparison
+    return BinarySearchTree<Key, Value>::find(key);
+}
+
+/**
+* @precondition The key exists in the map
+* Returns the value associated with the key, splaying its node.
+*/
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+    this->unshare();
+    Node<Key, Value>* node = this->internalFind(key);
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    if(shouldSplay()) {
+        splay(node);
+    }
+    return node->getValue();
+}
+
+/**
+* Walks down from the root to key and returns its node, or NULL if it is
+* missing. last is set to the last node visited either way. Unlike
+* internalFind this always walks, since a miss must splay the end of its
+* path.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::search(const Key& key, Node<Key, Value>*& last) const
+{
+    Node<Key, Value>* current = this->root_;
+    while(current != nullptr) {
+        last = current;
+        BST_STAT_ADD(comparisons, 1);
+        if(current->getKey() == key) {
+            return current;
+        }
+        else if(BST_STAT_ADD(comparisons, 1), current->getKey() < key) {
+            current = current->getRight();
+        }
+        else {
+            current = current->getLeft();
+        }
+    }
+    return nullptr;
+}
+
+/**
+* Moves node to the root with zig, zig-zig and zig-zag steps.
+*
+* Only nodes on the path from node to the root change children, so the
+* imbalance count is taken off for them up front. After each step, the
+* nodes rotated below node keep their subtrees for the rest of the splay,
+* so their heights are final and they are counted again.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::splay(Node<Key, Value>* node)
+{
+    for(Node<Key, Value>* ancestor = node; ancestor != nullptr; ancestor = ancestor->getParent()) {
+        if(this->isImbalanced(ancestor)) {
+            --this->imbalanced_;
+        }
+    }
+    while(node->getParent() != nullptr) {
+        Node<Key, Value>* parent = node->getParent();
+        Node<Key, Value>* grandparent = parent->getParent();
+        if(grandparent == nullptr) {
+            // zig
+            rotateUp(node);
+        }
+        else if((grandparent->getLeft() == parent) == (parent->getLeft() == node)) {
+            // zig-zig: rotate the parent first, then the node
+            rotateUp(parent);
+            rotateUp(node);
+        }
+        else {
+            // zig-zag: rotate the node twice
+            rotateUp(node);
+            rotateUp(node);
+        }
+        if(this->isImbalanced(parent)) {
+            ++this->imbalanced_;
+        }
+        if(grandparent != nullptr && this->isImbalanced(grandparent)) {
+            ++this->imbalanced_;
+        }
+    }
+    if(this->isImbalanced(node)) {
+        ++this->imbalanced_;
+    }
+}
+
+/**
+* Rotates node above its parent and recomputes both heights. The imbalance
+* count is left to splay.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::rotateUp(Node<Key, Value>* node)
+{
+    Node<Key, Value>* parent = node->getParent();
+    Node<Key, Value>* grandparent = parent->getParent();
+    if(parent->getLeft() == node) {
+        BST_STAT_ADD(rotateRights, 1);
+        Node<Key, Value>* inner = node->getRight();
+        parent->setLeft(inner);
+        if(inner != nullptr) {
+            inner->setParent(parent);
+        }
+        node->setRight(parent);
+    }
+    else {
+        BST_STAT_ADD(rotateLefts, 1);
+        Node<Key, Value>* inner = node->getLeft();
+        parent->setRight(inner);
+        if(inner != nullptr) {
+            inner->setParent(parent);
+        }
+        node->setLeft(parent);
+    }
+    parent->setParent(node);
+    node->setParent(grandparent);
+    if(grandparent == nullptr) {
+        this->root_ = node;
+    }
+    else if(grandparent->getLeft() == parent) {
+        grandparent->setLeft(node);
+    }
+    else {
+        grandparent->setRight(node);
+    }
+    updateHeight(parent);
+    updateHeight(node);
+}
+
+template<class Key, class Value>
+void SplayTree<Key, Value>::updateHeight(Node<Key, Value>* node)
+{
+    node->setHeight(1 + std::max(this->storedHeight(node->getLeft()), this->storedHeight(node->getRight())));
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef SPLIT_AVLBST_H
+#define SPLIT_AVLBST_H
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* An ordered map that keeps its keys and its values apart. The tree nodes
+* hold only a key, the links and the index of a slot in a pooled array of
+* values, so a search reads key-and-link cache lines and the value is
+* touched once, at the end. This pays off when values are large: with
+* inline storage every node on the search path drags its value's bytes
+* into the cache along with the key.
+*
+* Slots freed by remove are reused by later inserts. Pointers returned by
+* get stay valid until the next insert, which may grow the pool.
+*/
+template <typename Key, typename Value>
+class SplitAVLTree : protected AVLTree<Key, size_t>
+{
+public:
+    typedef AVLTree<Key, size_t> Index;
+
+    SplitAVLTree();
+
+    void insert(const std::pair<const Key, Value>& item);
+    void remove(const Key& key);
+    Value* get(const Key& key);
+    const Value* get(const Key& key) const;
+    Value& operator[](const Key& key);
+    const Value& operator[](const Key& key) const;
+    template<typename F>
+    void forEach(F f) const;
+    void clear();
+
+    size_t size() const { return values_.size() - freeSlots_.size(); }
+    using Index::empty;
+    using Index::height;
+    using Index::enableFindFilter;
+    using Index::disableFindFilter;
+    using Index::enableFindCache;
+    using Index::disableFindCache;
+    using Index::findCacheStats;
+
+protected:
+    size_t acquireSlot(const Value& value);
+    void releaseSlot(size_t slot);
+
+    std::vector<Value> values_;
+    std::vector<size_t> freeSlots_;
+};
+
+template<typename Key, typename Value>
+SplitAVLTree<Key, Value>::SplitAVLTree() : Index()
+{
+}
+
+template<typename Key, typename Value>
+size_t SplitAVLTree<Key, Value>::acquireSlot(const Value& value)
+{
+    if(freeSlots_.empty()) {
+        values_.push_back(value);
+        return values_.size() - 1;
+    }
+    size_t slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    values_[slot] = value;
+    return slot;
+}
+
+// Resets the slot so a freed value does not hold on to its resources
+template<typename Key, typename Value>
+void SplitAVLTree<Key, Value>::releaseSlot(size_t slot)
+{
+    values_[slot] = Value();
+    freeSlots_.push_back(slot);
+}
+
+/**
+* Inserts item, or overwrites the value if the key is already present.
+*/
+template<typename Key, typename Value>
+void SplitAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& item)
+{
+    Node<Key, size_t>* node = this->internalFind(item.first);
+    if(node != nullptr) {
+        //the key's slot is unchanged, so the index is left alone
+        values_[node->getValue()] = item.second;
+        return;
+    }
+    size_t slot = acquireSlot(item.second);
+    try {
+        this->insertNode(std::make_pair(item.first, slot));
+    }
+    catch(...) {
+        releaseSlot(slot);
+        throw;
+    }
+}
+
+template<typename Key, typename Value>
+void SplitAVLTree<Key, Value>::remove(const Key& key)
+{
+    this->unshare();
+    this->reclaim(this->reclaimBudget_);
+    Node<Key, size_t>* node = this->internalFind(key);
+    if(node == nullptr) {
+        return;
+    }
+    releaseSlot(node->getValue());
+    this->removeNode(static_cast<AVLNode<Key, size_t>*>(node));
+}
+
+/**
+* Returns the value for key, or NULL if key is not present.
+*/
+template<typename Key, typename Value>
+Value* SplitAVLTree<Key, Value>::get(const Key& key)
+{
+    Node<Key, size_t>* node = this->internalFind(key);
+    return node == nullptr ? nullptr : &values_[node->getValue()];
+}
+
+template<typename Key, typename Value>
+const Value* SplitAVLTree<Key, Value>::get(const Key& key) const
+{
+    Node<Key, size_t>* node = this->internalFind(key);
+    return node == nullptr ? nullptr : &values_[node->getValue()];
+}
+
+/**
+* @precondition The key exists in the map
+* Returns the value associated with the key
+*/
+template<typename Key, typename Value>
+Value& SplitAVLTree<Key, Value>::operator[](const Key& key)
+{
+    Value* value = get(key);
+    if(value == nullptr) throw std::out_of_range("Invalid key");
+    return *value;
+}
+
+template<typename Key, typename Value>
+const Value& SplitAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    const Value* value = get(key);
+    if(value == nullptr) throw std::out_of_range("Invalid key");
+    return *value;
+}
+
+/**
+* Calls f(key, value) for every entry in key order.
+*/
+template<typename Key, typename Value>
+template<typename F>
+void SplitAVLTree<Key, Value>::forEach(F f) const
+{
+    for(typename Index::iterator it = this->begin(); it != this->end(); ++it) {
+        f(it->first, values_[it->second]);
+    }
+}
+
+template<typename Key, typename Value>
+void SplitAVLTree<Key, Value>::clear()
+{
+    Index::clear();
+    values_.clear();
+    freeSlots_.clear();
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "check_trees.h"
+
+#include "augmented_avlbst.h"
+#include "interval_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+typedef AugmentedAVLTree<int, int, SumMonoid<int, int> > SumTree;
+
+// True if the entries reached through It can only be read
+template<typename It>
+struct ReadOnly
+{
+    static const bool value =
+        std::is_const<typename std::remove_reference<decltype((std::declval<It>()->second))>::type>::value &&
+        std::is_const<typename std::remove_reference<decltype(*std::declval<It>())>::type>::value;
+};
+
+//writes through iterators would leave the subtree summaries stale
+static_assert(ReadOnly<SumTree::iterator>::value, "AugmentedAVLTree iterators must be read-only");
+static_assert(ReadOnly<OrderStatisticTree<int, int>::iterator>::value, "OrderStatisticTree iterators must be read-only");
+static_assert(ReadOnly<IntervalTree<int, int>::iterator>::value, "IntervalTree iterators must be read-only");
+static_assert(ReadOnly<decltype(std::declval<SumTree&>().find(0))>::value, "find must return a read-only iterator");
+static_assert(ReadOnly<decltype(std::declval<OrderStatisticTree<int, int>&>().select(0))>::value,
+              "select must return a read-only iterator");
+
+TEST(AugmentedTree, AggregateMatchesTotal)
+{
+    SumTree tree;
+    for(int i = 0; i < 10; ++i) {
+        tree.insert(std::make_pair(i, 1));
+    }
+    tree.insert(std::make_pair(3, 100));
+    EXPECT_EQ(109, tree.total());
+    EXPECT_EQ(109, tree.aggregate(0, 9));
+    EXPECT_EQ(102, tree.aggregate(2, 4));
+    tree.remove(3);
+    EXPECT_EQ(9, tree.aggregate(0, 9));
+    EXPECT_EQ(9, tree.total());
+}
+
+TEST(AugmentedTree, IteratesInKeyOrder)
+{
+    SumTree tree;
+    for(int i = 9; i >= 0; --i) {
+        tree.insert(std::make_pair(i, i * i));
+    }
+    int expected = 0;
+    for(SumTree::iterator it = tree.begin(); it != tree.end(); ++it, ++expected) {
+        EXPECT_EQ(expected, it->first);
+        EXPECT_EQ(expected * expected, (*it).second);
+    }
+    EXPECT_EQ(10, expected);
+    EXPECT_EQ(16, tree.find(4)->second);
+    EXPECT_TRUE(tree.find(10) == tree.end());
+}
+
+TEST(OrderStatistic, SelectAndRank)
+{
+    OrderStatisticTree<int, int> tree;
+    for(int i = 0; i < 50; ++i) {
+        tree.insert(std::make_pair(i * 2, i));
+    }
+    for(size_t i = 0; i < 50; ++i) {
+        EXPECT_EQ(static_cast<int>(i * 2), tree.select(i)->first);
+        EXPECT_EQ(i, tree.rank(static_cast<int>(i * 2)));
+    }
+    EXPECT_TRUE(tree.select(0) == tree.begin());
+    EXPECT_THROW(tree.select(50), std::out_of_range);
+}
+
+TEST(IntervalTree, OverlappingAndFind)
+{
+    IntervalTree<int, int> tree;
+    for(int i = 0; i < 20; ++i) {
+        tree.insert(i * 10, i * 10 + 5, i);
+    }
+    std::vector<int> found;
+    tree.overlapping(12, 31, [&found](const std::pair<const Interval<int>, int>& item) {
+        found.push_back(item.second);
+    });
+    ASSERT_EQ(3u, found.size());
+    EXPECT_EQ(1, found[0]);
+    EXPECT_EQ(3, found[2]);
+
+    IntervalTree<int, int>::iterator it = tree.find(Interval<int>(30, 35));
+    ASSERT_TRUE(it != tree.end());
+    EXPECT_EQ(3, it->second);
+}
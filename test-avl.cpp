@@ -0,0 +1,74 @@
+#include "check_trees.h"
+
+#include "avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <utility>
+
+typedef AVLTree<int, int> Tree;
+
+TEST(AVLBalance, StoredBalancesMatchHeightsUnderChurn)
+{
+    Tree tree;
+    std::map<int, int> model;
+    std::mt19937 random(7);
+    for(int i = 0; i < 4000; ++i) {
+        int key = static_cast<int>(random() % 500);
+        if(random() % 3 == 0) {
+            tree.remove(key);
+            model.erase(key);
+        }
+        else {
+            tree.insert(std::make_pair(key, i));
+            model[key] = i;
+        }
+        ASSERT_TRUE(balancesMatchHeights(tree)) << "after operation " << i;
+    }
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(tree.verifyBalanced());
+    EXPECT_EQ(model, (contents<Tree, int, int>(tree)));
+}
+
+TEST(AVLBalance, SortedInsertsAndRemoves)
+{
+    Tree tree;
+    for(int i = 0; i < 1000; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    ASSERT_TRUE(balancesMatchHeights(tree));
+    EXPECT_EQ(10, tree.height());
+    for(int i = 999; i >= 0; i -= 2) {
+        tree.remove(i);
+        ASSERT_TRUE(balancesMatchHeights(tree)) << "after removing " << i;
+    }
+    EXPECT_TRUE(tree.isBalanced());
+}
+
+// Exposes the root so a test can damage a stored balance
+struct DamageableTree : public Tree
+{
+    AVLNode<int, int>* rootNode() { return static_cast<AVLNode<int, int>*>(root_); }
+};
+
+TEST(AVLBalance, IsBalancedChecksStoredBalances)
+{
+    DamageableTree tree;
+    EXPECT_TRUE(tree.isBalanced());
+    for(int i = 0; i < 15; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    EXPECT_TRUE(tree.isBalanced());
+
+    //the shape is still balanced; only the stored balance is wrong
+    AVLNode<int, int>* root = tree.rootNode();
+    int8_t balance = root->getBalance();
+    root->setBalance(static_cast<int8_t>(balance + 1));
+    EXPECT_FALSE(tree.isBalanced());
+    EXPECT_FALSE(balancesMatchHeights(tree));
+    EXPECT_TRUE(tree.verifyBalanced());
+    root->setBalance(balance);
+    EXPECT_TRUE(tree.isBalanced());
+}
@@ -0,0 +1,156 @@
+#include "check_trees.h"
+
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "bst_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <utility>
+
+template<typename Tree>
+static void fillTree(Tree& tree, int count)
+{
+    for(int i = 0; i < count; ++i) {
+        int key = (i * 37) % count;
+        tree.insert(std::make_pair(key, -key));
+    }
+}
+
+TEST(FindCache, CountsHitsAndMisses)
+{
+    AVLTree<int, int> tree;
+    fillTree(tree, 1000);
+    //large enough that the eight keys below get a set each
+    tree.enableFindCache(4096);
+    for(int round = 0; round < 10; ++round) {
+        for(int key = 0; key < 8; ++key) {
+            ASSERT_EQ(-key, tree.find(key)->second);
+        }
+    }
+    FindCacheStats stats = tree.findCacheStats();
+    EXPECT_EQ(80u, stats.hits + stats.misses);
+    EXPECT_EQ(8u, stats.misses);
+    EXPECT_TRUE(tree.find(5000) == tree.end());
+    tree.disableFindCache();
+    EXPECT_EQ(0u, tree.findCacheStats().hits);
+}
+
+// Removes cached keys, including ones whose removal swaps nodes, and checks every lookup
+template<typename Tree>
+static void removeCached()
+{
+    Tree tree;
+    fillTree(tree, 500);
+    tree.enableFindCache(128);
+    for(int key = 0; key < 500; ++key) {
+        tree.find(key);
+    }
+    for(int key = 0; key < 500; key += 2) {
+        tree.remove(key);
+    }
+    for(int key = 0; key < 500; ++key) {
+        typename Tree::iterator it = tree.find(key);
+        if(key % 2 == 0) {
+            ASSERT_TRUE(it == tree.end()) << "key " << key;
+        }
+        else {
+            ASSERT_TRUE(it != tree.end()) << "key " << key;
+            ASSERT_EQ(-key, it->second);
+        }
+    }
+    //a key inserted again lives in a new node
+    tree.insert(std::make_pair(4, 44));
+    EXPECT_EQ(44, tree.find(4)->second);
+    EXPECT_EQ(44, tree[4]);
+    tree[4] = 45;
+    EXPECT_EQ(45, tree.find(4)->second);
+}
+
+TEST(FindCache, RemoveDropsEntriesBST)
+{
+    removeCached<BinarySearchTree<int, int> >();
+}
+
+TEST(FindCache, RemoveDropsEntriesAVL)
+{
+    removeCached<AVLTree<int, int> >();
+}
+
+TEST(FindCache, RemoveDropsEntriesRedBlack)
+{
+    removeCached<RedBlackTree<int, int> >();
+}
+
+TEST(FindCache, EraseAndClearDropEntries)
+{
+    AVLTree<int, int> tree;
+    fillTree(tree, 200);
+    tree.enableFindCache(64);
+    for(int key = 0; key < 200; ++key) {
+        tree.find(key);
+    }
+    tree.erase(tree.find(10), tree.find(50));
+    tree.remove_if([](const std::pair<const int, int>& item) { return item.first >= 150; });
+    for(int key = 0; key < 200; ++key) {
+        bool present = key < 10 || (key >= 50 && key < 150);
+        ASSERT_EQ(present, tree.find(key) != tree.end()) << "key " << key;
+    }
+    tree.clear();
+    EXPECT_TRUE(tree.find(60) == tree.end());
+    tree.insert(std::make_pair(60, 6));
+    EXPECT_EQ(6, tree.find(60)->second);
+}
+
+TEST(FindCache, CopyOnWriteCopiesSeeTheirOwnValues)
+{
+    AVLTree<int, int> original;
+    original.setCopyOnWrite(true);
+    fillTree(original, 100);
+    original.enableFindCache(64);
+    for(int key = 0; key < 100; ++key) {
+        original.find(key);
+    }
+    AVLTree<int, int> copy(original);
+    copy.find(20);
+
+    //the write takes a private copy of the nodes the cache pointed at
+    original[20] = 2000;
+    original.remove(30);
+    EXPECT_EQ(2000, original.find(20)->second);
+    EXPECT_TRUE(original.find(30) == original.end());
+    EXPECT_EQ(-20, copy.find(20)->second);
+    EXPECT_EQ(-30, copy.find(30)->second);
+
+    copy.remove(20);
+    EXPECT_TRUE(copy.find(20) == copy.end());
+    EXPECT_EQ(2000, original.find(20)->second);
+}
+
+TEST(FindCache, HotKeysSurviveAScan)
+{
+    typedef Node<int, int> N;
+    N hot(0, 0, nullptr);
+    N cold(1, 1, nullptr);
+    FindCache<N> cache(4);
+    ASSERT_EQ(4u, cache.capacity());
+    //one set of four ways; every hash below lands in it
+    cache.insert(1, &hot);
+    EXPECT_EQ(&hot, cache.find(1, [](const N*) { return true; }));
+    //keys looked up once each only ever replace the last way
+    for(uint64_t h = 2; h < 100; ++h) {
+        cache.insert(h << 32, &cold);
+    }
+    EXPECT_EQ(&hot, cache.find(1, [](const N*) { return true; }));
+    EXPECT_EQ(&cold, cache.find(static_cast<uint64_t>(99) << 32, [](const N*) { return true; }));
+    EXPECT_TRUE(cache.find(static_cast<uint64_t>(98) << 32, [](const N*) { return true; }) == nullptr);
+
+    //a candidate whose key does not match is a miss
+    EXPECT_TRUE(cache.find(1, [](const N*) { return false; }) == nullptr);
+    cache.erase(1, &hot);
+    EXPECT_TRUE(cache.find(1, [](const N*) { return true; }) == nullptr);
+    FindCacheStats stats = cache.stats();
+    EXPECT_EQ(3u, stats.hits);
+    EXPECT_EQ(3u, stats.misses);
+}
@@ -0,0 +1,102 @@
+#include "check_trees.h"
+
+#include "concurrent_avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+* Runs readers beside one writer. The even keys are never touched by the
+* writer and must always be found; the odd keys between them come and go
+* but always map to themselves. Returns the number of lookups that broke
+* either rule.
+*/
+static size_t stressConcurrent(ConcurrentAVLTree<uint64_t, uint64_t>& tree, size_t n, unsigned readerCount)
+{
+    for(size_t k = 0; k < n; ++k) {
+        tree.insert(std::make_pair(2 * k, 2 * k));
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> lookups(0);
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> readers;
+    for(unsigned t = 0; t < readerCount; ++t) {
+        readers.push_back(std::thread([&tree, &stop, &lookups, &errors, t, n]() {
+            std::mt19937_64 random(t + 1);
+            size_t done = 0;
+            size_t bad = 0;
+            //keep reading until the writer is done, and at least a little
+            while(!stop.load(std::memory_order_relaxed) || done < 1000) {
+                uint64_t key = random() % (2 * n);
+                uint64_t value = 0;
+                bool found = tree.find(key, value);
+                if((key % 2 == 0 && !found) || (found && value != key)) {
+                    ++bad;
+                }
+                ++done;
+            }
+            lookups += done;
+            errors += bad;
+        }));
+    }
+    std::mt19937_64 random(0);
+    for(size_t i = 0; i < 2 * n; ++i) {
+        uint64_t key = 2 * (random() % n) + 1;
+        if(i % 2 == 0) {
+            tree.insert(std::make_pair(key, key));
+        }
+        else {
+            tree.remove(key);
+        }
+    }
+    stop = true;
+    for(size_t t = 0; t < readers.size(); ++t) {
+        readers[t].join();
+    }
+    EXPECT_GE(lookups.load(), 1000u * readerCount);
+    return errors.load();
+}
+
+TEST(ConcurrentAVL, ReadersBesideWriter)
+{
+    ConcurrentAVLTree<uint64_t, uint64_t> tree;
+    EXPECT_EQ(0u, stressConcurrent(tree, 20000, 4));
+    EXPECT_TRUE(tree.verify());
+    for(uint64_t k = 0; k < 40000; k += 2) {
+        uint64_t value = 0;
+        ASSERT_TRUE(tree.find(k, value));
+        EXPECT_EQ(k, value);
+    }
+}
+
+TEST(ConcurrentAVL, ReadersBeyondSlotsTakeTheLock)
+{
+    ConcurrentAVLTree<uint64_t, uint64_t> tree(2);
+    EXPECT_EQ(0u, stressConcurrent(tree, 5000, 6));
+    EXPECT_TRUE(tree.verify());
+}
+
+TEST(ConcurrentAVL, SingleThreaded)
+{
+    ConcurrentAVLTree<int, int> tree;
+    for(int i = 0; i < 1000; ++i) {
+        tree.insert(std::make_pair((i * 7) % 1000, i));
+    }
+    EXPECT_EQ(1000u, tree.size());
+    for(int i = 0; i < 1000; i += 2) {
+        tree.remove(i);
+    }
+    tree.insert(std::make_pair(1, -1));
+    tree.reclaim();
+    EXPECT_EQ(500u, tree.size());
+    EXPECT_TRUE(tree.verify());
+    int value = 0;
+    EXPECT_FALSE(tree.find(0, value));
+    ASSERT_TRUE(tree.find(1, value));
+    EXPECT_EQ(-1, value);
+}
@@ -0,0 +1,206 @@
+#include "check_trees.h"
+
+#include "bst.h"
+#include "avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+int LiveValue::live = 0;
+
+typedef std::map<int, int> Entries;
+
+// Exposes how many trees hold the nodes of a copy-on-write tree
+struct CountedTree : public AVLTree<int, int>
+{
+    int holders() const { return shared_ == nullptr ? 0 : shared_->load(); }
+};
+
+static void fillTree(BinarySearchTree<int, int>& tree, int count)
+{
+    for(int i = 0; i < count; ++i) {
+        tree.insert(std::make_pair(i, i * 10));
+    }
+}
+
+TEST(CopyTree, ClonedCopyIsIndependent)
+{
+    AVLTree<int, int> original;
+    fillTree(original, 20);
+    AVLTree<int, int> copy(original);
+
+    copy.insert(std::make_pair(100, 1));
+    copy.remove(3);
+    original.remove(5);
+
+    Entries originalEntries = contents<AVLTree<int, int>, int, int>(original);
+    Entries copyEntries = contents<AVLTree<int, int>, int, int>(copy);
+    EXPECT_EQ(19u, originalEntries.size());
+    EXPECT_EQ(0u, originalEntries.count(100));
+    EXPECT_EQ(1u, originalEntries.count(3));
+    EXPECT_EQ(20u, copyEntries.size());
+    EXPECT_EQ(1u, copyEntries.count(5));
+    EXPECT_TRUE(copy.verifyBalanced());
+    EXPECT_TRUE(balancesMatchHeights(copy));
+}
+
+TEST(CopyOnWrite, WritingCopyLeavesOriginal)
+{
+    AVLTree<int, int> original;
+    original.setCopyOnWrite(true);
+    fillTree(original, 20);
+    Entries before = contents<AVLTree<int, int>, int, int>(original);
+
+    AVLTree<int, int> copy(original);
+    copy.insert(std::make_pair(100, 1));
+    copy.remove(3);
+    copy[4] = -4;
+
+    EXPECT_EQ(before, (contents<AVLTree<int, int>, int, int>(original)));
+    Entries expected = before;
+    expected[100] = 1;
+    expected.erase(3);
+    expected[4] = -4;
+    EXPECT_EQ(expected, (contents<AVLTree<int, int>, int, int>(copy)));
+}
+
+TEST(CopyOnWrite, WritingOriginalLeavesCopy)
+{
+    BinarySearchTree<int, int> original;
+    original.setCopyOnWrite(true);
+    fillTree(original, 20);
+    Entries before = contents<BinarySearchTree<int, int>, int, int>(original);
+
+    BinarySearchTree<int, int> copy(original);
+    original.insert(std::make_pair(-1, 1));
+    original.remove(7);
+    original[8] = -8;
+
+    EXPECT_EQ(before, (contents<BinarySearchTree<int, int>, int, int>(copy)));
+    EXPECT_EQ(0u, (contents<BinarySearchTree<int, int>, int, int>(original).count(7)));
+    EXPECT_EQ(-8, original[8]);
+}
+
+TEST(CopyOnWrite, AssignmentShares)
+{
+    AVLTree<int, int> original;
+    original.setCopyOnWrite(true);
+    fillTree(original, 10);
+    AVLTree<int, int> copy;
+    copy.insert(std::make_pair(50, 50));
+    copy = original;
+    copy.clear();
+
+    EXPECT_EQ(10u, (contents<AVLTree<int, int>, int, int>(original).size()));
+    EXPECT_TRUE(copy.empty());
+}
+
+TEST(CopyOnWrite, LastHolderFreesSharedNodes)
+{
+    ASSERT_EQ(0, LiveValue::live);
+    {
+        AVLTree<int, LiveValue>* original = new AVLTree<int, LiveValue>();
+        original->setCopyOnWrite(true);
+        for(int i = 0; i < 10; ++i) {
+            original->insert(std::make_pair(i, LiveValue(i)));
+        }
+        EXPECT_EQ(10, LiveValue::live);
+
+        AVLTree<int, LiveValue> first(*original);
+        AVLTree<int, LiveValue> second(first);
+        //three trees, one set of nodes
+        EXPECT_EQ(10, LiveValue::live);
+
+        delete original;
+        EXPECT_EQ(10, LiveValue::live);
+        ASSERT_TRUE(first.find(9) != first.end());
+        EXPECT_EQ(9, first.find(9)->second.value);
+
+        //the first write takes a private copy, the other holder keeps the shared one
+        first.remove(0);
+        EXPECT_EQ(19, LiveValue::live);
+        second.clear();
+        EXPECT_EQ(9, LiveValue::live);
+        EXPECT_TRUE(second.empty());
+        EXPECT_EQ(9u, (contents<AVLTree<int, LiveValue>, int, LiveValue>(first).size()));
+    }
+    EXPECT_EQ(0, LiveValue::live);
+}
+
+TEST(CopyOnWrite, UnsharedAfterOtherHoldersLetGo)
+{
+    ASSERT_EQ(0, LiveValue::live);
+    {
+        AVLTree<int, LiveValue> original;
+        original.setCopyOnWrite(true);
+        for(int i = 0; i < 10; ++i) {
+            original.insert(std::make_pair(i, LiveValue(i)));
+        }
+        {
+            AVLTree<int, LiveValue> copy(original);
+            EXPECT_EQ(10, LiveValue::live);
+        }
+        //no one else holds the nodes, so writing must not clone them
+        original.insert(std::make_pair(10, LiveValue(10)));
+        EXPECT_EQ(11, LiveValue::live);
+    }
+    EXPECT_EQ(0, LiveValue::live);
+}
+
+TEST(CopyOnWrite, WritingThroughIteratorsLeavesCopies)
+{
+    AVLTree<int, int> original;
+    original.setCopyOnWrite(true);
+    fillTree(original, 20);
+    Entries before = contents<AVLTree<int, int>, int, int>(original);
+
+    AVLTree<int, int> first(original);
+    first.find(4)->second = -4;
+    AVLTree<int, int> second(original);
+    second.begin()->second = -100;
+
+    EXPECT_EQ(before, (contents<AVLTree<int, int>, int, int>(original)));
+    EXPECT_EQ(-4, first.find(4)->second);
+    EXPECT_EQ(0, first.begin()->second);
+    EXPECT_EQ(-100, second.begin()->second);
+    EXPECT_EQ(40, second.find(4)->second);
+
+    //reading through a const tree does not take a private copy
+    const AVLTree<int, int>& view = original;
+    AVLTree<int, int> third(original);
+    EXPECT_EQ(40, view.find(4)->second);
+    EXPECT_EQ(0, view.begin()->second);
+}
+
+TEST(CopyOnWrite, ConcurrentCopiesOfConstTree)
+{
+    CountedTree original;
+    original.setCopyOnWrite(true);
+    fillTree(original, 100);
+    ASSERT_EQ(1, original.holders());
+    const CountedTree& source = original;
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([&source]() {
+            for(int i = 0; i < 2000; ++i) {
+                AVLTree<int, int> copy(source);
+                if(i % 100 == 0) {
+                    copy.remove(i % 100);
+                }
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    //every copy let go of its share
+    EXPECT_EQ(1, original.holders());
+    EXPECT_EQ(100u, (contents<AVLTree<int, int>, int, int>(original).size()));
+    original.remove(50);
+    EXPECT_EQ(99u, (contents<AVLTree<int, int>, int, int>(original).size()));
+}
@@ -0,0 +1,112 @@
+#include "check_trees.h"
+
+#include "durable_avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <utility>
+#include <dirent.h>
+#include <unistd.h>
+
+static std::string storeDir()
+{
+    return testing::TempDir() + "tree-tests-durable";
+}
+
+static void removeStore()
+{
+    std::string dir = storeDir();
+    DIR* d = opendir(dir.c_str());
+    if(d == NULL) {
+        return;
+    }
+    while(struct dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if(name != "." && name != "..") {
+            unlink((dir + "/" + name).c_str());
+        }
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+// Returns the highest n of the files named prefix.<n> in the store, or -1
+static long newestFile(const std::string& prefix)
+{
+    long newest = -1;
+    DIR* d = opendir(storeDir().c_str());
+    if(d == NULL) {
+        return newest;
+    }
+    while(struct dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if(name.compare(0, prefix.size() + 1, prefix + ".") == 0 && name.find(".tmp") == std::string::npos) {
+            newest = std::max(newest, std::strtol(name.c_str() + prefix.size() + 1, NULL, 10));
+        }
+    }
+    closedir(d);
+    return newest;
+}
+
+// Waits up to five seconds for a file named prefix.<segment> or later to appear
+static bool waitForFile(const std::string& prefix, long segment)
+{
+    for(int i = 0; i < 500; ++i) {
+        if(newestFile(prefix) >= segment) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+TEST(DurableTree, RecoversAfterReopen)
+{
+    removeStore();
+    {
+        DurableAVLTree<int, int> store(storeDir(), DurabilityPolicy(1, 0, 50));
+        for(int i = 0; i < 200; ++i) {
+            store.insert(std::make_pair(i, i * 2));
+        }
+        store.remove(7);
+    }
+    DurableAVLTree<int, int> store(storeDir());
+    int value = 0;
+    EXPECT_TRUE(store.find(199, value));
+    EXPECT_EQ(398, value);
+    EXPECT_FALSE(store.find(7, value));
+    removeStore();
+}
+
+TEST(DurableTree, SnapshotRequestedDuringSnapshotIsWritten)
+{
+    removeStore();
+    const size_t everyOps = 100;
+    {
+        //a large tree makes the background snapshot slow to write
+        DurableAVLTree<int, int> store(storeDir(), DurabilityPolicy(0, 0, 0));
+        for(int i = 0; i < 300000; ++i) {
+            store.insert(std::make_pair(i, i));
+        }
+    }
+    DurableAVLTree<int, int> store(storeDir(), DurabilityPolicy(0, 0, everyOps));
+    long segment = newestFile("log");
+    ASSERT_GE(segment, 0);
+
+    //the first batch requests a snapshot, which opens a new log segment
+    //before it writes the tree out. The second batch lands during the write
+    //and must get a snapshot of its own with no further writes.
+    for(size_t i = 0; i < everyOps; ++i) {
+        store.insert(std::make_pair(-1, static_cast<int>(i)));
+    }
+    ASSERT_TRUE(waitForFile("log", segment + 1));
+    for(size_t i = 0; i < everyOps + everyOps / 2; ++i) {
+        store.insert(std::make_pair(-2, static_cast<int>(i)));
+    }
+    EXPECT_TRUE(waitForFile("snapshot", segment + 2));
+    removeStore();
+}
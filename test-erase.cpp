@@ -0,0 +1,155 @@
+#include "check_trees.h"
+
+#include "avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+typedef AVLTree<int, int> Tree;
+typedef std::map<int, int> Entries;
+
+static void fillTree(Tree& tree, Entries& expected, int count)
+{
+    for(int i = 0; i < count; ++i) {
+        int key = (i * 37) % count;
+        tree.insert(std::make_pair(key, -key));
+        expected[key] = -key;
+    }
+}
+
+// Both the shape and the stored balances, which the next erase relies on
+static bool verifiedAfterErase(const Tree& tree)
+{
+    return tree.verifyBalanced() && balancesMatchHeights(tree);
+}
+
+TEST(AVLErase, SingleReturnsNext)
+{
+    Tree tree;
+    Entries expected;
+    fillTree(tree, expected, 100);
+    Tree::iterator kept = tree.find(50);
+    for(int key = 0; key < 96; key += 3) {
+        Tree::iterator next = tree.erase(tree.find(key));
+        expected.erase(key);
+        ASSERT_TRUE(next != tree.end());
+        EXPECT_EQ(key + 1, next->first);
+        ASSERT_TRUE(verifiedAfterErase(tree)) << "after erasing " << key;
+    }
+    //iterators to surviving entries stay valid
+    EXPECT_EQ(50, kept->first);
+    EXPECT_EQ(-50, kept->second);
+    EXPECT_TRUE(tree.erase(tree.find(99)) == tree.end());
+    expected.erase(99);
+    EXPECT_EQ(expected, (contents<Tree, int, int>(tree)));
+}
+
+TEST(AVLErase, Ranges)
+{
+    Tree tree;
+    Entries expected;
+    fillTree(tree, expected, 200);
+    Tree::iterator kept = tree.find(150);
+
+    //empty range
+    EXPECT_TRUE(tree.erase(tree.find(10), tree.find(10)) == tree.find(10));
+    //middle
+    Tree::iterator last = tree.erase(tree.find(20), tree.find(120));
+    EXPECT_EQ(120, last->first);
+    expected.erase(expected.find(20), expected.find(120));
+    EXPECT_EQ(expected, (contents<Tree, int, int>(tree)));
+    EXPECT_TRUE(verifiedAfterErase(tree));
+    //prefix
+    tree.erase(tree.begin(), tree.find(5));
+    expected.erase(expected.begin(), expected.find(5));
+    EXPECT_TRUE(verifiedAfterErase(tree));
+    //suffix
+    EXPECT_TRUE(tree.erase(tree.find(180), tree.end()) == tree.end());
+    expected.erase(expected.find(180), expected.end());
+    EXPECT_EQ(expected, (contents<Tree, int, int>(tree)));
+    EXPECT_TRUE(verifiedAfterErase(tree));
+    EXPECT_EQ(150, kept->first);
+
+    tree.erase(tree.begin(), tree.end());
+    EXPECT_TRUE(tree.empty());
+}
+
+TEST(AVLErase, RemoveIf)
+{
+    Tree tree;
+    Entries expected;
+    fillTree(tree, expected, 300);
+    std::vector<int> seen;
+    size_t removed = tree.remove_if([&seen](const std::pair<const int, int>& item) {
+        seen.push_back(item.first);
+        return item.first % 3 != 0;
+    });
+    EXPECT_EQ(200u, removed);
+    //pred sees every entry once, in key order
+    ASSERT_EQ(300u, seen.size());
+    for(int i = 0; i < 300; ++i) {
+        EXPECT_EQ(i, seen[i]);
+    }
+    for(Entries::iterator it = expected.begin(); it != expected.end(); ) {
+        if(it->first % 3 != 0) {
+            expected.erase(it++);
+        }
+        else {
+            ++it;
+        }
+    }
+    EXPECT_EQ(expected, (contents<Tree, int, int>(tree)));
+    EXPECT_TRUE(verifiedAfterErase(tree));
+    EXPECT_EQ(0u, tree.remove_if([](const std::pair<const int, int>&) { return false; }));
+    //a contiguous run of removals rebalances the same side over and over
+    EXPECT_EQ(50u, tree.remove_if([](const std::pair<const int, int>& item) { return item.first < 150; }));
+    EXPECT_TRUE(verifiedAfterErase(tree));
+    EXPECT_EQ(50u, tree.remove_if([](const std::pair<const int, int>&) { return true; }));
+    EXPECT_TRUE(tree.empty());
+}
+
+TEST(AVLErase, CopyOnWriteLeavesOtherCopies)
+{
+    Tree original;
+    Entries expected;
+    original.setCopyOnWrite(true);
+    fillTree(original, expected, 50);
+    Tree first(original);
+    Tree second(original);
+
+    //iterators of a shared tree point at shared nodes
+    first.erase(first.find(10));
+    second.erase(second.find(10), second.find(40));
+    original.remove_if([](const std::pair<const int, int>& item) { return item.first < 25; });
+
+    Entries firstExpected = expected;
+    firstExpected.erase(10);
+    Entries secondExpected = expected;
+    secondExpected.erase(secondExpected.find(10), secondExpected.find(40));
+    expected.erase(expected.begin(), expected.find(25));
+    EXPECT_EQ(firstExpected, (contents<Tree, int, int>(first)));
+    EXPECT_EQ(secondExpected, (contents<Tree, int, int>(second)));
+    EXPECT_EQ(expected, (contents<Tree, int, int>(original)));
+    EXPECT_TRUE(verifiedAfterErase(first));
+    EXPECT_TRUE(verifiedAfterErase(second));
+    EXPECT_TRUE(verifiedAfterErase(original));
+}
+
+TEST(AVLErase, FreesErasedNodes)
+{
+    ASSERT_EQ(0, LiveValue::live);
+    {
+        AVLTree<int, LiveValue> tree;
+        for(int i = 0; i < 100; ++i) {
+            tree.insert(std::make_pair(i, LiveValue(i)));
+        }
+        tree.erase(tree.find(0));
+        tree.erase(tree.find(10), tree.find(20));
+        tree.remove_if([](const std::pair<const int, LiveValue>& item) { return item.first >= 50; });
+        EXPECT_EQ(39, LiveValue::live);
+    }
+    EXPECT_EQ(0, LiveValue::live);
+}
@@ -0,0 +1,149 @@
+#include "check_trees.h"
+
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "bst_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <utility>
+
+// Exposes the hash the trees feed their filters
+struct FilterHash : public BinarySearchTree<int, int>
+{
+    using BinarySearchTree<int, int>::hashKey;
+};
+
+// Checks that tree finds exactly the keys in expected among [lo, hi)
+template<typename Tree>
+static void expectKeys(const Tree& tree, const std::set<int>& expected, int lo, int hi)
+{
+    for(int key = lo; key < hi; ++key) {
+        bool found = tree.find(key) != tree.end();
+        ASSERT_EQ(expected.count(key) == 1, found) << "key " << key;
+    }
+}
+
+template<typename Tree>
+static void churn(Tree& tree)
+{
+    std::set<int> expected;
+    for(int i = 0; i < 3000; ++i) {
+        int key = (i * 7919) % 6000;
+        tree.insert(std::make_pair(key, i));
+        expected.insert(key);
+    }
+    tree.enableFindFilter();
+    expectKeys(tree, expected, -100, 6100);
+
+    //removing most keys makes the filter rebuild several times
+    for(int i = 0; i < 2500; ++i) {
+        int key = (i * 7919) % 6000;
+        tree.remove(key);
+        expected.erase(key);
+    }
+    expectKeys(tree, expected, -100, 6100);
+
+    //growing well past the size the filter was built for
+    for(int key = 6000; key < 20000; key += 3) {
+        tree.insert(std::make_pair(key, key));
+        expected.insert(key);
+    }
+    expectKeys(tree, expected, -100, 20100);
+    EXPECT_GT(tree.findFilterBytes(), 0u);
+
+    tree.clear();
+    expected.clear();
+    expectKeys(tree, expected, -100, 100);
+    tree.insert(std::make_pair(42, 42));
+    expected.insert(42);
+    expectKeys(tree, expected, -100, 100);
+
+    tree.disableFindFilter();
+    EXPECT_EQ(0u, tree.findFilterBytes());
+    expectKeys(tree, expected, -100, 100);
+}
+
+TEST(FindFilter, NoFalseNegativesBST)
+{
+    BinarySearchTree<int, int> tree;
+    churn(tree);
+}
+
+TEST(FindFilter, NoFalseNegativesAVL)
+{
+    AVLTree<int, int> tree;
+    churn(tree);
+}
+
+TEST(FindFilter, NoFalseNegativesRedBlack)
+{
+    RedBlackTree<int, int> tree;
+    churn(tree);
+}
+
+TEST(FindFilter, CopiesKeepTheirOwnFilter)
+{
+    AVLTree<int, int> original;
+    original.setCopyOnWrite(true);
+    original.enableFindFilter();
+    std::set<int> expected;
+    for(int key = 0; key < 500; ++key) {
+        original.insert(std::make_pair(key, key));
+        expected.insert(key);
+    }
+    AVLTree<int, int> copy(original);
+    std::set<int> copyExpected = expected;
+    for(int key = 500; key < 600; ++key) {
+        copy.insert(std::make_pair(key, key));
+        copyExpected.insert(key);
+    }
+    original.remove(7);
+    expected.erase(7);
+    expectKeys(original, expected, -10, 610);
+    expectKeys(copy, copyExpected, -10, 610);
+}
+
+TEST(FindFilter, FalsePositiveRate)
+{
+    const int keys = 20000;
+    const int probes = 200000;
+    KeyFilter filter(0.01, 0.25);
+    filter.reset(keys);
+    for(int key = 0; key < keys; ++key) {
+        filter.add(FilterHash::hashKey(key));
+    }
+    int falsePositives = 0;
+    for(int key = keys; key < keys + probes; ++key) {
+        if(filter.mightContain(FilterHash::hashKey(key))) {
+            ++falsePositives;
+        }
+    }
+    //about 1% at the configured rate; 2% leaves room for the blocked layout
+    EXPECT_LT(falsePositives, probes / 50);
+    EXPECT_GT(falsePositives, 0);
+}
+
+TEST(FindFilter, NeedsRebuild)
+{
+    KeyFilter filter(0.01, 0.25);
+    filter.reset(2000);
+    for(int key = 0; key < 2000; ++key) {
+        filter.add(FilterHash::hashKey(key));
+    }
+    EXPECT_FALSE(filter.needsRebuild());
+    for(int i = 0; i < 500; ++i) {
+        filter.noteRemoved();
+    }
+    EXPECT_FALSE(filter.needsRebuild());
+    filter.noteRemoved();
+    EXPECT_TRUE(filter.needsRebuild());
+
+    filter.reset(2000);
+    for(int key = 0; key <= 2000; ++key) {
+        filter.add(FilterHash::hashKey(key));
+    }
+    EXPECT_TRUE(filter.needsRebuild());
+}
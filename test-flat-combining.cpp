@@ -0,0 +1,165 @@
+#include "check_trees.h"
+
+#include "flat_combining.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef FlatCombiningTree<int, int> CombiningTree;
+
+static const int KEYS_PER_THREAD = 300;
+
+/**
+* Has each of threadCount threads insert its own block of keys, find them
+* all, remove the odd ones and check they are gone. Returns the number of
+* lookups that saw the wrong answer.
+*/
+static size_t runOwnKeys(CombiningTree& tree, unsigned threadCount)
+{
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < threadCount; ++t) {
+        threads.push_back(std::thread([&tree, &errors, t]() {
+            int base = static_cast<int>(t) * KEYS_PER_THREAD;
+            size_t bad = 0;
+            for(int i = 0; i < KEYS_PER_THREAD; ++i) {
+                tree.insert(std::make_pair(base + i, -(base + i)));
+            }
+            for(int i = 0; i < KEYS_PER_THREAD; ++i) {
+                int value = 0;
+                if(!tree.find(base + i, value) || value != -(base + i)) {
+                    ++bad;
+                }
+            }
+            for(int i = 1; i < KEYS_PER_THREAD; i += 2) {
+                tree.remove(base + i);
+            }
+            for(int i = 0; i < KEYS_PER_THREAD; ++i) {
+                int value = 0;
+                if(tree.find(base + i, value) != (i % 2 == 0)) {
+                    ++bad;
+                }
+            }
+            errors += bad;
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    return errors;
+}
+
+static void expectEvenKeysLeft(CombiningTree& tree, unsigned threadCount)
+{
+    std::map<int, int> expected;
+    for(int key = 0; key < static_cast<int>(threadCount) * KEYS_PER_THREAD; key += 2) {
+        expected[key] = -key;
+    }
+    tree.read([&expected](const AVLTree<int, int>& contentsTree) {
+        EXPECT_EQ(expected, (contents<AVLTree<int, int>, int, int>(contentsTree)));
+        EXPECT_TRUE(contentsTree.verifyBalanced());
+    });
+}
+
+TEST(FlatCombining, ThreadsApplyTheirOwnKeys)
+{
+    CombiningTree tree;
+    EXPECT_EQ(0u, runOwnKeys(tree, 6));
+    expectEvenKeysLeft(tree, 6);
+}
+
+TEST(FlatCombining, ThreadsWithoutSlotsTakeTheLock)
+{
+    // more threads than slots, so some requests bypass the combiner
+    CombiningTree tree(2);
+    EXPECT_EQ(0u, runOwnKeys(tree, 6));
+    expectEvenKeysLeft(tree, 6);
+}
+
+/**
+* A value whose copy constructor throws for POISON. Assignment never
+* throws, so posting the request succeeds and the tree's insert, which
+* copies the value into a node, is what fails.
+*/
+struct PoisonValue
+{
+    static const int POISON = -1;
+
+    PoisonValue() : value(0) {}
+    explicit PoisonValue(int v) : value(v) {}
+    PoisonValue(const PoisonValue& other) : value(other.value)
+    {
+        if(value == POISON) {
+            throw std::runtime_error("poisoned value");
+        }
+    }
+    PoisonValue& operator=(const PoisonValue& other)
+    {
+        value = other.value;
+        return *this;
+    }
+
+    int value;
+};
+
+// printBST and gtest need to print values
+static std::ostream& operator<<(std::ostream& out, const PoisonValue& value)
+{
+    return out << value.value;
+}
+
+TEST(FlatCombining, ExceptionsReachThePostingThread)
+{
+    FlatCombiningTree<int, PoisonValue> tree;
+    std::atomic<size_t> caught(0);
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([&tree, &caught, &errors, t]() {
+            int base = static_cast<int>(t) * 100;
+            for(int i = 0; i < 100; ++i) {
+                // only thread 0 posts poisoned values, on every tenth key
+                bool poisoned = t == 0 && i % 10 == 0;
+                try {
+                    tree.insert(std::make_pair(base + i, PoisonValue(poisoned ? PoisonValue::POISON : i)));
+                    if(poisoned) {
+                        ++errors;
+                    }
+                }
+                catch(const std::runtime_error&) {
+                    if(poisoned) {
+                        ++caught;
+                    }
+                    else {
+                        ++errors;
+                    }
+                }
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    EXPECT_EQ(10u, caught.load());
+    EXPECT_EQ(0u, errors.load());
+
+    // the failed inserts left nothing behind, and the rest went in
+    size_t entries = 0;
+    tree.read([&entries](const AVLTree<int, PoisonValue>& contentsTree) {
+        for(AVLTree<int, PoisonValue>::iterator it = contentsTree.begin(); it != contentsTree.end(); ++it) {
+            EXPECT_FALSE(it->first < 100 && it->first % 10 == 0) << it->first;
+            ++entries;
+        }
+    });
+    EXPECT_EQ(390u, entries);
+    PoisonValue value;
+    EXPECT_FALSE(tree.find(0, value));
+    EXPECT_TRUE(tree.find(1, value));
+    EXPECT_EQ(1, value.value);
+}
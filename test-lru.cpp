@@ -0,0 +1,189 @@
+#include "check_trees.h"
+
+#include "lru_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+typedef OrderedLRUCache<int, int> Cache;
+
+// Charges each entry its value, so tests can pick sizes directly
+static size_t valueBytes(const int&, const int& value)
+{
+    return static_cast<size_t>(value);
+}
+
+static std::vector<int> keysOf(Cache& cache)
+{
+    std::vector<int> keys;
+    for(Cache::iterator it = cache.begin(); it != cache.end(); ++it) {
+        keys.push_back(it->first);
+    }
+    return keys;
+}
+
+TEST(OrderedLRUCache, EvictsLeastRecentAtEntryCapacity)
+{
+    Cache cache(3);
+    for(int key = 1; key <= 3; ++key) {
+        cache.put(key, key * 10);
+    }
+    EXPECT_EQ(3u, cache.size());
+    ASSERT_NE(nullptr, cache.coldest());
+    EXPECT_EQ(1, cache.coldest()->first);
+
+    cache.put(4, 40);
+    EXPECT_EQ(3u, cache.size());
+    EXPECT_EQ(nullptr, cache.peek(1));
+    EXPECT_EQ(2, cache.coldest()->first);
+
+    cache.put(5, 50);
+    cache.put(6, 60);
+    EXPECT_EQ((std::vector<int>{4, 5, 6}), keysOf(cache));
+}
+
+TEST(OrderedLRUCache, GetRefreshesRecency)
+{
+    Cache cache(3);
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+    ASSERT_NE(nullptr, cache.get(1));
+    EXPECT_EQ(10, *cache.get(1));
+    cache.put(4, 40);
+    EXPECT_EQ((std::vector<int>{1, 3, 4}), keysOf(cache));
+    EXPECT_EQ(nullptr, cache.get(2));
+
+    // overwriting refreshes as well
+    cache.put(3, 31);
+    cache.put(5, 50);
+    EXPECT_EQ((std::vector<int>{3, 4, 5}), keysOf(cache));
+    EXPECT_EQ(31, *cache.peek(3));
+}
+
+TEST(OrderedLRUCache, PeekScanAndIterationKeepRecency)
+{
+    Cache cache(3);
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+
+    ASSERT_NE(nullptr, cache.peek(1));
+    EXPECT_EQ(10, *cache.peek(1));
+    std::vector<int> scanned;
+    cache.scan(0, 5, [&scanned](const std::pair<const int, int>& item) { scanned.push_back(item.first); });
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), scanned);
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), keysOf(cache));
+    EXPECT_EQ(1, cache.coldest()->first);
+
+    cache.put(4, 40);
+    EXPECT_EQ(nullptr, cache.peek(1));
+    EXPECT_EQ(2, cache.coldest()->first);
+}
+
+TEST(OrderedLRUCache, ScanIsInclusiveAndInKeyOrder)
+{
+    Cache cache(100);
+    for(int key = 20; key > 0; key -= 2) {
+        cache.put(key, key);
+    }
+    std::vector<int> scanned;
+    cache.scan(5, 12, [&scanned](const std::pair<const int, int>& item) { scanned.push_back(item.first); });
+    EXPECT_EQ((std::vector<int>{6, 8, 10, 12}), scanned);
+}
+
+TEST(OrderedLRUCache, OverwriteRechargesBytes)
+{
+    Cache cache(100, CACHE_LIMIT_BYTES, valueBytes);
+    cache.put(1, 30);
+    cache.put(2, 30);
+    EXPECT_EQ(60u, cache.bytes());
+    cache.put(1, 50);
+    EXPECT_EQ(80u, cache.bytes());
+    EXPECT_EQ(2u, cache.size());
+    cache.put(1, 10);
+    EXPECT_EQ(40u, cache.bytes());
+
+    // 1 was refreshed by its overwrite, so 2 is the one to go
+    cache.put(3, 70);
+    EXPECT_EQ(80u, cache.bytes());
+    EXPECT_EQ((std::vector<int>{1, 3}), keysOf(cache));
+}
+
+TEST(OrderedLRUCache, OversizedEntryIsEvictedAtOnce)
+{
+    Cache cache(100, CACHE_LIMIT_BYTES, valueBytes);
+    cache.put(1, 20);
+    cache.put(2, 30);
+    cache.put(3, 150);
+    EXPECT_EQ(nullptr, cache.peek(3));
+    EXPECT_EQ((std::vector<int>{1, 2}), keysOf(cache));
+    EXPECT_EQ(50u, cache.bytes());
+
+    // growing an existing entry past the capacity drops it too
+    cache.put(1, 101);
+    EXPECT_EQ(nullptr, cache.peek(1));
+    EXPECT_EQ(1u, cache.size());
+    EXPECT_EQ(30u, cache.bytes());
+}
+
+TEST(OrderedLRUCache, EraseAndEvictKeepCountsConsistent)
+{
+    Cache cache(4000, CACHE_LIMIT_BYTES, valueBytes);
+    std::mt19937 random(42);
+    for(int i = 0; i < 5000; ++i) {
+        int key = static_cast<int>(random() % 200);
+        switch(random() % 4) {
+        case 0:
+            cache.erase(key);
+            break;
+        case 1:
+            cache.evict();
+            break;
+        default:
+            cache.put(key, static_cast<int>(random() % 100));
+            break;
+        }
+        size_t entries = 0;
+        size_t bytes = 0;
+        int previous = -1;
+        for(Cache::iterator it = cache.begin(); it != cache.end(); ++it) {
+            ASSERT_LT(previous, it->first);
+            previous = it->first;
+            ++entries;
+            bytes += static_cast<size_t>(it->second);
+        }
+        ASSERT_EQ(entries, cache.size()) << "after operation " << i;
+        ASSERT_EQ(bytes, cache.bytes()) << "after operation " << i;
+        ASSERT_LE(cache.bytes(), cache.capacity());
+        ASSERT_EQ(entries == 0, cache.empty());
+    }
+
+    while(cache.evict()) {
+    }
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_EQ(0u, cache.bytes());
+    EXPECT_EQ(nullptr, cache.coldest());
+    EXPECT_FALSE(cache.erase(1));
+    EXPECT_FALSE(cache.evict());
+}
+
+TEST(OrderedLRUCache, ShrinkingCapacityEvictsColdest)
+{
+    Cache cache(5);
+    for(int key = 1; key <= 5; ++key) {
+        cache.put(key, key);
+    }
+    cache.get(1);
+    cache.setCapacity(2);
+    EXPECT_EQ((std::vector<int>{1, 5}), keysOf(cache));
+    cache.clear();
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_EQ(nullptr, cache.coldest());
+    cache.put(7, 7);
+    EXPECT_EQ(7, cache.coldest()->first);
+}
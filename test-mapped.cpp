@@ -0,0 +1,147 @@
+#include "check_trees.h"
+
+#include "bst.h"
+#include "mapped_bst.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+typedef MappedTreeView<int, int> View;
+typedef View::Record Record;
+
+static std::string imagePath()
+{
+    return testing::TempDir() + "tree-tests-mapped.img";
+}
+
+// Writes an image of the keys 0, 2, ..., 2 * (count - 1); count must not be a multiple of 7
+static void writeImage(int count)
+{
+    BinarySearchTree<int, int> tree;
+    for(int i = 0; i < count; ++i) {
+        //insert in a scrambled order so the tree has both left and right links
+        tree.insert(std::make_pair(2 * ((i * 7 + count / 2) % count), i));
+    }
+    writeMappedTree(tree, imagePath().c_str());
+}
+
+static uint32_t readRoot()
+{
+    uint32_t root = MAPPED_NIL;
+    std::ifstream in(imagePath().c_str(), std::ios::binary);
+    in.seekg(offsetof(MappedTreeHeader, root));
+    in.read(reinterpret_cast<char*>(&root), sizeof(root));
+    return root;
+}
+
+template<typename T>
+static void patch(size_t offset, T value)
+{
+    std::fstream file(imagePath().c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static size_t linkOffset(uint32_t record, size_t field)
+{
+    return MAPPED_DATA_OFFSET + record * sizeof(Record) + field;
+}
+
+TEST(MappedTree, SearchesMatchTree)
+{
+    writeImage(101);
+    View view(imagePath().c_str());
+    EXPECT_EQ(101u, view.size());
+    int expected = 0;
+    for(View::iterator it = view.begin(); it != view.end(); ++it, expected += 2) {
+        EXPECT_EQ(expected, it->key);
+        EXPECT_TRUE(view.find(expected) == it);
+    }
+    EXPECT_TRUE(view.find(3) == view.end());
+    EXPECT_EQ(4, view.lowerBound(3)->key);
+    EXPECT_EQ(4, view.lowerBound(4)->key);
+    EXPECT_EQ(6, view.upperBound(4)->key);
+    EXPECT_TRUE(view.upperBound(200) == view.end());
+}
+
+TEST(MappedTree, EmptyImage)
+{
+    writeImage(0);
+    View view(imagePath().c_str());
+    EXPECT_TRUE(view.empty());
+    EXPECT_TRUE(view.find(0) == view.end());
+    EXPECT_TRUE(view.lowerBound(0) == view.end());
+}
+
+TEST(MappedTree, RejectsBadHeaders)
+{
+    writeImage(10);
+    patch<char>(0, 'X');
+    EXPECT_THROW(View view(imagePath().c_str()), std::runtime_error);
+
+    writeImage(10);
+    patch<uint64_t>(offsetof(MappedTreeHeader, count), 11);
+    EXPECT_THROW(View view(imagePath().c_str()), std::runtime_error);
+
+    writeImage(10);
+    patch<uint64_t>(offsetof(MappedTreeHeader, dataOffset), 1 << 20);
+    EXPECT_THROW(View view(imagePath().c_str()), std::runtime_error);
+
+    writeImage(10);
+    typedef MappedTreeView<int, double> OtherView;
+    EXPECT_THROW(OtherView view(imagePath().c_str()), std::runtime_error);
+}
+
+TEST(MappedTree, RejectsCountThatOverflowsLength)
+{
+    writeImage(10);
+    //count * sizeof(Record) wraps around to the real data length
+    uint64_t count = 10 + (static_cast<uint64_t>(1) << 63) / sizeof(Record) * 2;
+    ASSERT_EQ(10 * sizeof(Record), count * sizeof(Record));
+    patch<uint64_t>(offsetof(MappedTreeHeader, count), count);
+    EXPECT_THROW(View view(imagePath().c_str()), std::runtime_error);
+}
+
+TEST(MappedTree, RejectsRootOutOfRange)
+{
+    writeImage(10);
+    patch<uint32_t>(offsetof(MappedTreeHeader, root), 10);
+    EXPECT_THROW(View view(imagePath().c_str()), std::runtime_error);
+
+    writeImage(0);
+    patch<uint32_t>(offsetof(MappedTreeHeader, root), 0);
+    EXPECT_THROW(View view(imagePath().c_str()), std::runtime_error);
+}
+
+TEST(MappedTree, BadChildLinkThrowsOnDescent)
+{
+    writeImage(10);
+    uint32_t root = readRoot();
+    ASSERT_LT(root, 9u);
+    patch<uint32_t>(linkOffset(root, offsetof(Record, right)), 1000);
+    View view(imagePath().c_str());
+    EXPECT_THROW(view.find(18), std::runtime_error);
+    EXPECT_THROW(view.lowerBound(17), std::runtime_error);
+    EXPECT_THROW(view.upperBound(17), std::runtime_error);
+    //the other side of the tree is still searchable
+    EXPECT_EQ(0, view.find(0)->key);
+}
+
+TEST(MappedTree, CycleDoesNotLoop)
+{
+    writeImage(10);
+    uint32_t root = readRoot();
+    ASSERT_GT(root, 0u);
+
+    //point the root's left child back at the root
+    patch<uint32_t>(linkOffset(root, offsetof(Record, left)), root);
+    View view(imagePath().c_str());
+    EXPECT_THROW(view.find(-1), std::runtime_error);
+    EXPECT_THROW(view.lowerBound(-1), std::runtime_error);
+    EXPECT_THROW(view.upperBound(-1), std::runtime_error);
+}
@@ -0,0 +1,107 @@
+#include "check_trees.h"
+
+#include "rbbst.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <utility>
+
+typedef RedBlackTree<int, int> Tree;
+
+static RBNode<int, int>* rbRoot(const Tree& tree)
+{
+    return static_cast<RBNode<int, int>*>(RootAccess<int, int>::of(tree));
+}
+
+TEST(RedBlackInvariants, HoldUnderChurn)
+{
+    Tree tree;
+    std::map<int, int> model;
+    std::mt19937 random(21);
+    for(int i = 0; i < 6000; ++i) {
+        int key = static_cast<int>(random() % 700);
+        if(random() % 3 == 0) {
+            tree.remove(key);
+            model.erase(key);
+        }
+        else {
+            tree.insert(std::make_pair(key, i));
+            model[key] = i;
+        }
+        ASSERT_TRUE(tree.isBalanced()) << "after operation " << i;
+    }
+    EXPECT_EQ(model, (contents<Tree, int, int>(tree)));
+}
+
+TEST(RedBlackInvariants, HoldForSortedInsertsAndRemoves)
+{
+    Tree tree;
+    for(int i = 0; i < 1000; ++i) {
+        tree.insert(std::make_pair(i, i));
+        ASSERT_TRUE(tree.isBalanced()) << "after inserting " << i;
+    }
+    for(int i = 0; i < 1000; i += 2) {
+        tree.remove(i);
+        ASSERT_TRUE(tree.isBalanced()) << "after removing " << i;
+    }
+    EXPECT_EQ(500u, (contents<Tree, int, int>(tree).size()));
+}
+
+TEST(RedBlackInvariants, DetectBrokenColors)
+{
+    Tree tree;
+    EXPECT_TRUE(tree.isBalanced());
+    for(int i = 0; i < 100; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    ASSERT_TRUE(tree.isBalanced());
+    // a red root breaks the first rule
+    RBNode<int, int>* root = rbRoot(tree);
+    root->setColor(RB_RED);
+    EXPECT_FALSE(tree.isBalanced());
+    root->setColor(RB_BLACK);
+    // recoloring one black child red changes the black height of its paths
+    RBNode<int, int>* child = root->getLeft();
+    ASSERT_EQ(RB_BLACK, child->getColor());
+    child->setColor(RB_RED);
+    EXPECT_FALSE(tree.isBalanced());
+    child->setColor(RB_BLACK);
+    EXPECT_TRUE(tree.isBalanced());
+}
+
+TEST(RedBlackCopy, KeepsColorsAndIsIndependent)
+{
+    Tree tree;
+    std::map<int, int> model;
+    std::mt19937 random(22);
+    for(int i = 0; i < 2000; ++i) {
+        int key = static_cast<int>(random() % 400);
+        if(random() % 4 == 0) {
+            tree.remove(key);
+            model.erase(key);
+        }
+        else {
+            tree.insert(std::make_pair(key, i));
+            model[key] = i;
+        }
+    }
+    Tree copy(tree);
+    ASSERT_TRUE(copy.isBalanced());
+    EXPECT_EQ(model, (contents<Tree, int, int>(copy)));
+    EXPECT_EQ(rbRoot(tree)->getColor(), rbRoot(copy)->getColor());
+
+    // changes to either side stay on that side and keep both valid
+    std::map<int, int> copyModel = model;
+    for(int i = 0; i < 400; i += 3) {
+        copy.remove(i);
+        copyModel.erase(i);
+        tree.insert(std::make_pair(i + 1000, i));
+        model[i + 1000] = i;
+    }
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(copy.isBalanced());
+    EXPECT_EQ(model, (contents<Tree, int, int>(tree)));
+    EXPECT_EQ(copyModel, (contents<Tree, int, int>(copy)));
+}
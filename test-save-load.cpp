@@ -0,0 +1,199 @@
+#include "check_trees.h"
+
+#include "avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+typedef std::map<int, double> Entries;
+
+static std::string saved(const AVLTree<int, double>& tree)
+{
+    std::ostringstream out;
+    tree.save(out);
+    return out.str();
+}
+
+static void loadFrom(AVLTree<int, double>& tree, const std::string& bytes)
+{
+    std::istringstream in(bytes);
+    tree.load(in);
+}
+
+TEST(SaveLoad, EmptyTree)
+{
+    AVLTree<int, double> tree, loaded;
+    loaded.insert(std::make_pair(1, 1.0));
+    loadFrom(loaded, saved(tree));
+    EXPECT_TRUE(loaded.empty());
+}
+
+TEST(SaveLoad, RoundTripKeepsEntriesAndBalance)
+{
+    for(int n = 1; n <= 300; n += 37) {
+        AVLTree<int, double> tree;
+        for(int i = 0; i < n; ++i) {
+            int key = (i * 7919) % 1009;
+            tree.insert(std::make_pair(key, key / 2.0));
+        }
+        AVLTree<int, double> loaded;
+        loadFrom(loaded, saved(tree));
+        EXPECT_EQ((contents<AVLTree<int, double>, int, double>(tree)), (contents<AVLTree<int, double>, int, double>(loaded)));
+        EXPECT_TRUE(loaded.verifyBalanced());
+    }
+}
+
+TEST(SaveLoad, LoadedTreeAcceptsUpdates)
+{
+    AVLTree<int, double> tree;
+    for(int i = 0; i < 100; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    AVLTree<int, double> loaded;
+    loadFrom(loaded, saved(tree));
+    for(int i = 0; i < 100; i += 3) {
+        loaded.remove(i);
+    }
+    for(int i = 100; i < 150; ++i) {
+        loaded.insert(std::make_pair(i, i));
+    }
+    EXPECT_TRUE(loaded.verifyBalanced());
+    EXPECT_EQ(116u, (contents<AVLTree<int, double>, int, double>(loaded).size()));
+    EXPECT_TRUE(loaded.find(3) == loaded.end());
+    EXPECT_TRUE(loaded.find(149) != loaded.end());
+}
+
+TEST(SaveLoad, LoadReplacesContents)
+{
+    AVLTree<int, double> tree, loaded;
+    tree.insert(std::make_pair(5, 5.0));
+    loaded.insert(std::make_pair(1, 1.0));
+    loaded.insert(std::make_pair(9, 9.0));
+    loadFrom(loaded, saved(tree));
+    Entries expected;
+    expected[5] = 5.0;
+    EXPECT_EQ(expected, (contents<AVLTree<int, double>, int, double>(loaded)));
+}
+
+TEST(SaveLoad, LoadRefillsFindFilter)
+{
+    AVLTree<int, double> tree, loaded;
+    for(int i = 0; i < 2000; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    loaded.enableFindFilter();
+    loadFrom(loaded, saved(tree));
+    for(int i = 0; i < 2000; ++i) {
+        ASSERT_TRUE(loaded.find(i) != loaded.end());
+    }
+}
+
+TEST(SaveLoad, RejectsBadMagic)
+{
+    AVLTree<int, double> tree, loaded;
+    tree.insert(std::make_pair(1, 1.0));
+    std::string bytes = saved(tree);
+    bytes[0] = 'X';
+    EXPECT_THROW(loadFrom(loaded, bytes), std::runtime_error);
+    EXPECT_THROW(loadFrom(loaded, "AV"), std::runtime_error);
+}
+
+TEST(SaveLoad, RejectsOtherVersion)
+{
+    AVLTree<int, double> tree, loaded;
+    std::string bytes = saved(tree);
+    uint32_t version = AVL_FILE_VERSION + 1;
+    std::memcpy(&bytes[offsetof(AVLFileHeader, version)], &version, sizeof(version));
+    EXPECT_THROW(loadFrom(loaded, bytes), std::runtime_error);
+}
+
+TEST(SaveLoad, RejectsOtherRecordSizes)
+{
+    AVLTree<int, double> tree;
+    tree.insert(std::make_pair(1, 1.0));
+    AVLTree<int, int> loaded;
+    std::istringstream in(saved(tree));
+    EXPECT_THROW(loaded.load(in), std::runtime_error);
+}
+
+// Replaces the key of record index in a saved file of AVLTree<int, double>
+static void setRecordKey(std::string& bytes, size_t index, int key)
+{
+    size_t offset = sizeof(AVLFileHeader) + index * (sizeof(int) + sizeof(double));
+    std::memcpy(&bytes[offset], &key, sizeof(key));
+}
+
+static AVLTree<int, double> keptTree()
+{
+    AVLTree<int, double> tree;
+    tree.insert(std::make_pair(-1, -1.0));
+    tree.insert(std::make_pair(-2, -2.0));
+    return tree;
+}
+
+TEST(SaveLoad, TruncatedBodyKeepsOldContents)
+{
+    AVLTree<int, double> tree;
+    for(int i = 0; i < 50; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    std::string bytes = saved(tree);
+    AVLTree<int, double> loaded = keptTree();
+    Entries before = contents<AVLTree<int, double>, int, double>(loaded);
+    EXPECT_THROW(loadFrom(loaded, bytes.substr(0, bytes.size() - 5)), std::runtime_error);
+    EXPECT_EQ(before, (contents<AVLTree<int, double>, int, double>(loaded)));
+    //cut inside the header's record count worth of records
+    EXPECT_THROW(loadFrom(loaded, bytes.substr(0, sizeof(AVLFileHeader) + 7)), std::runtime_error);
+    EXPECT_EQ(before, (contents<AVLTree<int, double>, int, double>(loaded)));
+    EXPECT_TRUE(loaded.verifyBalanced());
+}
+
+TEST(SaveLoad, RejectsUnsortedRecords)
+{
+    AVLTree<int, double> tree;
+    for(int i = 0; i < 50; ++i) {
+        tree.insert(std::make_pair(i * 2, i));
+    }
+    AVLTree<int, double> loaded = keptTree();
+    Entries before = contents<AVLTree<int, double>, int, double>(loaded);
+
+    std::string swapped = saved(tree);
+    setRecordKey(swapped, 20, 100);
+    EXPECT_THROW(loadFrom(loaded, swapped), std::runtime_error);
+    EXPECT_EQ(before, (contents<AVLTree<int, double>, int, double>(loaded)));
+
+    std::string duplicate = saved(tree);
+    setRecordKey(duplicate, 49, 96);
+    EXPECT_THROW(loadFrom(loaded, duplicate), std::runtime_error);
+    std::string first = saved(tree);
+    setRecordKey(first, 0, 2);
+    EXPECT_THROW(loadFrom(loaded, first), std::runtime_error);
+    EXPECT_EQ(before, (contents<AVLTree<int, double>, int, double>(loaded)));
+
+    //the untouched file still loads
+    loadFrom(loaded, saved(tree));
+    EXPECT_EQ((contents<AVLTree<int, double>, int, double>(tree)), (contents<AVLTree<int, double>, int, double>(loaded)));
+}
+
+TEST(SaveLoad, CopyOnWriteTreeLoads)
+{
+    AVLTree<int, double> tree;
+    for(int i = 0; i < 20; ++i) {
+        tree.insert(std::make_pair(i, i));
+    }
+    AVLTree<int, double> loaded = keptTree();
+    loaded.setCopyOnWrite(true);
+    AVLTree<int, double> copy(loaded);
+    loadFrom(loaded, saved(tree));
+    AVLTree<int, double> second(loaded);
+    second.remove(3);
+    EXPECT_EQ(2u, (contents<AVLTree<int, double>, int, double>(copy).size()));
+    EXPECT_EQ(20u, (contents<AVLTree<int, double>, int, double>(loaded).size()));
+    EXPECT_EQ(19u, (contents<AVLTree<int, double>, int, double>(second).size()));
+}
@@ -0,0 +1,135 @@
+#include "check_trees.h"
+
+#include "splaybst.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <utility>
+
+typedef SplayTree<int, int> Tree;
+
+static int rootKey(const Tree& tree)
+{
+    return RootAccess<int, int>::of(tree)->getKey();
+}
+
+// Builds the path 0 - 10 - 20 - ... - 90 down the right spine without
+// splaying, so every key but 0 is a long way from the root.
+static void fillSpine(Tree& tree)
+{
+    tree.setSplayPeriod(1000);
+    for(int key = 0; key < 100; key += 10) {
+        tree.insert(std::make_pair(key, key));
+    }
+}
+
+static void runModel(unsigned splayPeriod, unsigned seed)
+{
+    Tree tree(splayPeriod);
+    std::map<int, int> model;
+    std::mt19937 random(seed);
+    for(int i = 0; i < 5000; ++i) {
+        int key = static_cast<int>(random() % 300);
+        switch(random() % 3) {
+        case 0:
+            tree.insert(std::make_pair(key, i));
+            model[key] = i;
+            break;
+        case 1:
+            tree.remove(key);
+            model.erase(key);
+            break;
+        default: {
+            Tree::iterator it = tree.find(key);
+            std::map<int, int>::iterator expected = model.find(key);
+            if(expected == model.end()) {
+                ASSERT_TRUE(it == tree.end()) << "key " << key << " at operation " << i;
+            }
+            else {
+                ASSERT_FALSE(it == tree.end()) << "key " << key << " at operation " << i;
+                ASSERT_EQ(expected->second, it->second);
+            }
+            break;
+        }
+        }
+        ASSERT_EQ(tree.verifyBalanced(), tree.isBalanced()) << "after operation " << i;
+    }
+    EXPECT_EQ(model, (contents<Tree, int, int>(tree)));
+}
+
+TEST(SplayTree, MatchesMapModel)
+{
+    runModel(1, 11);
+}
+
+TEST(SplayTree, MatchesMapModelWithSplayPeriod)
+{
+    runModel(3, 12);
+}
+
+TEST(SplayTree, FindHitMovesNodeToRoot)
+{
+    Tree tree;
+    fillSpine(tree);
+    tree.setSplayPeriod(1);
+    Tree::iterator it = tree.find(70);
+    ASSERT_FALSE(it == tree.end());
+    EXPECT_EQ(70, it->second);
+    EXPECT_EQ(70, rootKey(tree));
+}
+
+TEST(SplayTree, FindMissSplaysLastVisitedNode)
+{
+    Tree tree;
+    fillSpine(tree);
+    tree.setSplayPeriod(1);
+    // 85 falls off the spine below 90, the last node on its path
+    EXPECT_TRUE(tree.find(85) == tree.end());
+    EXPECT_EQ(90, rootKey(tree));
+    // and past the end of the keys the miss ends at the same node
+    EXPECT_TRUE(tree.find(1000) == tree.end());
+    EXPECT_EQ(90, rootKey(tree));
+    EXPECT_TRUE(tree.find(-5) == tree.end());
+    EXPECT_EQ(0, rootKey(tree));
+    EXPECT_EQ(10u, (contents<Tree, int, int>(tree).size()));
+}
+
+TEST(SplayTree, FindMissOnEmptyTree)
+{
+    Tree tree;
+    EXPECT_TRUE(tree.find(1) == tree.end());
+    EXPECT_TRUE(tree.empty());
+}
+
+TEST(SplayTree, SplayPeriodSkipsAccesses)
+{
+    Tree tree;
+    fillSpine(tree);
+    tree.setSplayPeriod(3);
+    // the first two accesses are plain lookups, the third splays
+    ASSERT_FALSE(tree.find(90) == tree.end());
+    EXPECT_EQ(0, rootKey(tree));
+    ASSERT_FALSE(tree.find(80) == tree.end());
+    EXPECT_EQ(0, rootKey(tree));
+    ASSERT_FALSE(tree.find(60) == tree.end());
+    EXPECT_EQ(60, rootKey(tree));
+    // misses count toward the period too
+    EXPECT_TRUE(tree.find(95) == tree.end());
+    EXPECT_TRUE(tree.find(95) == tree.end());
+    EXPECT_EQ(60, rootKey(tree));
+    EXPECT_TRUE(tree.find(95) == tree.end());
+    EXPECT_EQ(90, rootKey(tree));
+}
+
+TEST(SplayTree, ConstFindDoesNotSplay)
+{
+    Tree tree;
+    fillSpine(tree);
+    tree.setSplayPeriod(1);
+    const Tree& view = tree;
+    EXPECT_FALSE(view.find(70) == view.end());
+    EXPECT_TRUE(view.find(75) == view.end());
+    EXPECT_EQ(0, rootKey(tree));
+}
@@ -0,0 +1,133 @@
+#include "check_trees.h"
+
+#include "split_avlbst.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Exposes the value pool so the tests can see which slots are in use
+struct SlotTree : public SplitAVLTree<int, std::string>
+{
+    size_t slots() const { return values_.size(); }
+    size_t freeSlots() const { return freeSlots_.size(); }
+    const std::string& slot(size_t index) const { return values_[index]; }
+};
+
+static std::vector<std::pair<int, std::string> > entries(const SlotTree& tree)
+{
+    std::vector<std::pair<int, std::string> > result;
+    tree.forEach([&result](const int& key, const std::string& value) { result.push_back(std::make_pair(key, value)); });
+    return result;
+}
+
+TEST(SplitAVLTree, OverwriteReusesSlot)
+{
+    SlotTree tree;
+    tree.insert(std::make_pair(1, std::string("one")));
+    tree.insert(std::make_pair(2, std::string("two")));
+    ASSERT_EQ(2u, tree.slots());
+    tree.insert(std::make_pair(1, std::string("uno")));
+    EXPECT_EQ(2u, tree.slots());
+    EXPECT_EQ(0u, tree.freeSlots());
+    EXPECT_EQ(2u, tree.size());
+    ASSERT_NE(nullptr, tree.get(1));
+    EXPECT_EQ("uno", *tree.get(1));
+    EXPECT_EQ("two", tree[2]);
+}
+
+TEST(SplitAVLTree, RemoveThenInsertReusesFreedSlot)
+{
+    SlotTree tree;
+    for(int key = 0; key < 10; ++key) {
+        tree.insert(std::make_pair(key, std::to_string(key)));
+    }
+    tree.remove(3);
+    tree.remove(7);
+    EXPECT_EQ(8u, tree.size());
+    EXPECT_EQ(10u, tree.slots());
+    EXPECT_EQ(2u, tree.freeSlots());
+    // freed slots are reset rather than left holding the old values
+    for(size_t i = 0; i < tree.slots(); ++i) {
+        EXPECT_NE("3", tree.slot(i));
+        EXPECT_NE("7", tree.slot(i));
+    }
+    // removing a missing key frees nothing
+    tree.remove(42);
+    EXPECT_EQ(2u, tree.freeSlots());
+
+    tree.insert(std::make_pair(20, std::string("twenty")));
+    tree.insert(std::make_pair(21, std::string("twenty-one")));
+    EXPECT_EQ(10u, tree.slots());
+    EXPECT_EQ(0u, tree.freeSlots());
+    EXPECT_EQ(10u, tree.size());
+    EXPECT_EQ("twenty", tree[20]);
+    EXPECT_EQ("twenty-one", tree[21]);
+    EXPECT_EQ(nullptr, tree.get(3));
+
+    tree.insert(std::make_pair(22, std::string("twenty-two")));
+    EXPECT_EQ(11u, tree.slots());
+}
+
+TEST(SplitAVLTree, MissingKeys)
+{
+    SlotTree tree;
+    EXPECT_EQ(nullptr, tree.get(1));
+    EXPECT_THROW(tree[1], std::out_of_range);
+    tree.insert(std::make_pair(1, std::string("one")));
+    const SlotTree& view = tree;
+    EXPECT_EQ(nullptr, view.get(2));
+    EXPECT_THROW(view[2], std::out_of_range);
+    ASSERT_NE(nullptr, view.get(1));
+    EXPECT_EQ("one", view[1]);
+    tree.remove(1);
+    EXPECT_EQ(nullptr, tree.get(1));
+    EXPECT_THROW(tree[1], std::out_of_range);
+}
+
+TEST(SplitAVLTree, ForEachVisitsKeysInOrder)
+{
+    SlotTree tree;
+    std::map<int, std::string> model;
+    std::mt19937 random(31);
+    for(int i = 0; i < 3000; ++i) {
+        int key = static_cast<int>(random() % 400);
+        if(random() % 3 == 0) {
+            tree.remove(key);
+            model.erase(key);
+        }
+        else {
+            tree.insert(std::make_pair(key, std::to_string(i)));
+            model[key] = std::to_string(i);
+        }
+    }
+    std::vector<std::pair<int, std::string> > expected(model.begin(), model.end());
+    EXPECT_EQ(expected, entries(tree));
+    EXPECT_EQ(model.size(), tree.size());
+    EXPECT_EQ(tree.size() + tree.freeSlots(), tree.slots());
+}
+
+TEST(SplitAVLTree, ClearEmptiesPoolAndIndex)
+{
+    SlotTree tree;
+    for(int key = 0; key < 50; ++key) {
+        tree.insert(std::make_pair(key, std::to_string(key)));
+    }
+    tree.remove(10);
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(0u, tree.size());
+    EXPECT_EQ(0u, tree.slots());
+    EXPECT_EQ(0u, tree.freeSlots());
+    EXPECT_EQ(nullptr, tree.get(5));
+    EXPECT_TRUE(entries(tree).empty());
+
+    tree.insert(std::make_pair(5, std::string("five")));
+    EXPECT_EQ(1u, tree.slots());
+    EXPECT_EQ("five", tree[5]);
+}